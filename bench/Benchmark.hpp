@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal microbenchmark harness. Benchmarks register themselves with
+// LYKTA_BENCHMARK and receive the number of iterations they should run.
+namespace Lykta {
+	namespace Bench {
+
+		// Prevents the compiler from optimizing away a benchmarked value
+		template <typename T>
+		inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+			asm volatile("" : : "r,m"(value) : "memory");
+#else
+			static volatile const void* sink;
+			sink = &value;
+#endif
+		}
+
+		typedef std::function<void(size_t)> Body;
+
+		struct Result {
+			std::string name;
+			size_t iterations;
+			double seconds;
+
+			double nsPerOp() const {
+				return 1e9 * seconds / iterations;
+			}
+
+			double opsPerSecond() const {
+				return iterations / seconds;
+			}
+		};
+
+		class Registry {
+		public:
+			static std::vector<std::pair<std::string, Body> >& benchmarks() {
+				static std::vector<std::pair<std::string, Body> > registered;
+				return registered;
+			}
+
+			static bool add(const std::string& name, Body body) {
+				benchmarks().push_back(std::make_pair(name, body));
+				return true;
+			}
+		};
+
+		// Runs body with growing iteration counts until one run lasts at least minTime seconds
+		inline Result run(const std::string& name, const Body& body, double minTime) {
+			Result result;
+			result.name = name;
+			size_t iterations = 1;
+
+			// Zero iterations only build lazily initialized inputs, which are not timed
+			body(0);
+
+			while (true) {
+				auto startTime = std::chrono::steady_clock::now();
+				body(iterations);
+				auto endTime = std::chrono::steady_clock::now();
+				double seconds = std::chrono::duration<double>(endTime - startTime).count();
+
+				if (seconds >= minTime || iterations >= (size_t(1) << 40)) {
+					result.iterations = iterations;
+					result.seconds = seconds;
+					return result;
+				}
+
+				// Aim slightly past minTime, but never grow more than 10x per step
+				double scale = (seconds > 0.0) ? 1.4 * minTime / seconds : 10.0;
+				iterations = (size_t)(iterations * std::min(std::max(scale, 2.0), 10.0));
+			}
+		}
+	}
+}
+
+#define LYKTA_BENCHMARK(function, name) \
+	static void function(size_t iterations); \
+	static bool function##Registered = Lykta::Bench::Registry::add(name, function); \
+	static void function(size_t iterations)
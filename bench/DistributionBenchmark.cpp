@@ -0,0 +1,118 @@
+#include "Benchmark.hpp"
+#include "Distribution.hpp"
+#include "random.h"
+
+using namespace Lykta;
+
+namespace {
+	const int NUM_SAMPLES = 4096;
+
+	// Skewed weights, similar to the luminance of an environment map with a sun
+	std::vector<float> makeWeights(int n) {
+		RandomSampler rng;
+		std::vector<float> weights(n);
+		for (float& w : weights) {
+			float r = rng.next();
+			w = r * r * r * r + EPS;
+		}
+		return weights;
+	}
+
+	std::vector<float> makeSamples() {
+		RandomSampler rng;
+		std::vector<float> samples(NUM_SAMPLES);
+		for (float& s : samples) s = rng.next();
+		return samples;
+	}
+
+	// Reference for the previous implementation, binary search over a normalized CDF
+	class CDFDistribution {
+	private:
+		std::vector<float> cdf;
+
+	public:
+		CDFDistribution(const std::vector<float>& weights) : cdf(weights.size()) {
+			cdf[0] = weights[0];
+			for (size_t i = 1; i < weights.size(); i++) cdf[i] = cdf[i - 1] + weights[i];
+			for (float& c : cdf) c /= cdf.back();
+		}
+
+		int sample(float r) const {
+			auto it = std::lower_bound(cdf.begin(), cdf.end(), r);
+			return (it != cdf.end()) ? (int)std::distance(cdf.begin(), it) : (int)cdf.size() - 1;
+		}
+	};
+
+	// Tables are built once per size so that only sampling is timed
+	template <int N>
+	void sampleCDF(size_t iterations) {
+		static const std::vector<float> samples = makeSamples();
+		static const CDFDistribution distribution(makeWeights(N));
+		for (size_t i = 0; i < iterations; i++) {
+			Bench::doNotOptimize(distribution.sample(samples[i % NUM_SAMPLES]));
+		}
+	}
+
+	template <int N>
+	void sampleAlias(size_t iterations) {
+		static const std::vector<float> samples = makeSamples();
+		static const Distribution1D distribution(makeWeights(N));
+		float pdf;
+		for (size_t i = 0; i < iterations; i++) {
+			Bench::doNotOptimize(distribution.sample(samples[i % NUM_SAMPLES], pdf));
+		}
+	}
+
+	// Luminance-like image with a bright spot, sampled like an environment map
+	template <int W, int H>
+	void sample2D(size_t iterations) {
+		static const std::vector<float> samples = makeSamples();
+		static const std::vector<float> weights = makeWeights(W * H);
+		static const Distribution2D distribution(W, H, [](int i, int j) { return weights[j * W + i]; });
+		float pdf;
+		for (size_t i = 0; i < iterations; i++) {
+			glm::vec2 sample = glm::vec2(samples[i % NUM_SAMPLES], samples[(i * 7 + 1) % NUM_SAMPLES]);
+			Bench::doNotOptimize(distribution.sample(sample, pdf));
+		}
+	}
+
+	void buildAlias(size_t iterations, int n) {
+		std::vector<float> weights = makeWeights(n);
+		for (size_t i = 0; i < iterations; i++) {
+			Distribution1D distribution(weights);
+			Bench::doNotOptimize(distribution.getSum());
+		}
+	}
+}
+
+LYKTA_BENCHMARK(distributionCDF1K, "distribution/sample/cdf/1K") {
+	sampleCDF<(1 << 10)>(iterations);
+}
+
+LYKTA_BENCHMARK(distributionAlias1K, "distribution/sample/alias/1K") {
+	sampleAlias<(1 << 10)>(iterations);
+}
+
+LYKTA_BENCHMARK(distributionCDF1M, "distribution/sample/cdf/1M") {
+	sampleCDF<(1 << 20)>(iterations);
+}
+
+LYKTA_BENCHMARK(distributionAlias1M, "distribution/sample/alias/1M") {
+	sampleAlias<(1 << 20)>(iterations);
+}
+
+LYKTA_BENCHMARK(distributionCDF16M, "distribution/sample/cdf/16M") {
+	sampleCDF<(1 << 24)>(iterations);
+}
+
+LYKTA_BENCHMARK(distributionAlias16M, "distribution/sample/alias/16M") {
+	sampleAlias<(1 << 24)>(iterations);
+}
+
+LYKTA_BENCHMARK(distribution2D2K, "distribution/sample/2D/2Kx1K") {
+	sample2D<2048, 1024>(iterations);
+}
+
+LYKTA_BENCHMARK(distributionBuildAlias1M, "distribution/build/alias/1M") {
+	buildAlias(iterations, 1 << 20);
+}
@@ -0,0 +1,76 @@
+#include "Benchmark.hpp"
+#include "Emitter.hpp"
+#include "random.h"
+
+using namespace Lykta;
+
+namespace {
+	const int NUM_SAMPLES = 4096;
+	const int MAP_WIDTH = 1024;
+
+	std::vector<glm::vec3> makeSamples() {
+		RandomSampler rng;
+		std::vector<glm::vec3> samples(NUM_SAMPLES);
+		for (glm::vec3& s : samples) s = glm::vec3(rng.next(), rng.next(), rng.next());
+		return samples;
+	}
+
+	std::vector<glm::vec3> makeDirections() {
+		RandomSampler rng;
+		std::vector<glm::vec3> directions(NUM_SAMPLES);
+		for (glm::vec3& d : directions) {
+			float z = 1.f - 2.f * rng.next();
+			float r = sqrtf(fmaxf(0.f, 1.f - z * z));
+			float phi = 2.f * M_PI * rng.next();
+			d = glm::vec3(r * cosf(phi), r * sinf(phi), z);
+		}
+		return directions;
+	}
+
+	EnvironmentEmitter makeEmitter(EnvironmentMapping mapping) {
+		int height = (mapping == EnvironmentMapping::LATLONG) ? MAP_WIDTH / 2 : MAP_WIDTH;
+		ImagePtr<glm::vec3> image = ImagePtr<glm::vec3>(new Image<glm::vec3>(MAP_WIDTH, height));
+		RandomSampler rng;
+		for (int i = 0; i < MAP_WIDTH * height; i++) (*image)[i] = glm::vec3(rng.next());
+		return EnvironmentEmitter(TexturePtr<glm::vec3>(new Texture<glm::vec3>(image)), 1.f, 0.3f, mapping);
+	}
+
+	// Next event estimation towards the environment
+	template <EnvironmentMapping mapping>
+	void sampleEmitter(size_t iterations) {
+		static const std::vector<glm::vec3> samples = makeSamples();
+		static const EnvironmentEmitter emitter = makeEmitter(mapping);
+		EmitterInteraction ei = EmitterInteraction(glm::vec3(0.f));
+		for (size_t i = 0; i < iterations; i++) {
+			Bench::doNotOptimize(emitter.sample(samples[i % NUM_SAMPLES], ei));
+		}
+	}
+
+	// Escaped rays
+	template <EnvironmentMapping mapping>
+	void evalEmitter(size_t iterations) {
+		static const std::vector<glm::vec3> directions = makeDirections();
+		static const EnvironmentEmitter emitter = makeEmitter(mapping);
+		EmitterInteraction ei = EmitterInteraction(glm::vec3(0.f));
+		for (size_t i = 0; i < iterations; i++) {
+			ei.direction = directions[i % NUM_SAMPLES];
+			Bench::doNotOptimize(emitter.eval(ei));
+		}
+	}
+}
+
+LYKTA_BENCHMARK(environmentSampleLatlong, "environment/sample/latlong") {
+	sampleEmitter<EnvironmentMapping::LATLONG>(iterations);
+}
+
+LYKTA_BENCHMARK(environmentSampleOctahedral, "environment/sample/octahedral") {
+	sampleEmitter<EnvironmentMapping::OCTAHEDRAL>(iterations);
+}
+
+LYKTA_BENCHMARK(environmentEvalLatlong, "environment/eval/latlong") {
+	evalEmitter<EnvironmentMapping::LATLONG>(iterations);
+}
+
+LYKTA_BENCHMARK(environmentEvalOctahedral, "environment/eval/octahedral") {
+	evalEmitter<EnvironmentMapping::OCTAHEDRAL>(iterations);
+}
@@ -0,0 +1,135 @@
+#include "Benchmark.hpp"
+#include "Camera.hpp"
+#include "RealisticCamera.hpp"
+#include "Scene.hpp"
+#include "random.h"
+
+using namespace Lykta;
+
+namespace {
+	const int NUM_SAMPLES = 4096;
+	const glm::ivec2 RESOLUTION = glm::ivec2(1920, 1080);
+
+	std::vector<glm::vec3> makeSamples() {
+		RandomSampler rng;
+		std::vector<glm::vec3> samples(NUM_SAMPLES);
+		for (glm::vec3& s : samples) s = rng.next3D();
+		return samples;
+	}
+
+	glm::mat4 cameraToWorld() {
+		return lookAt(glm::vec3(0.f, 1.f, 6.f), glm::vec3(0.f, 1.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+	}
+
+	// Double Gauss 50mm lens (pbrt-v3 dgauss.50mm), listed from the sensor outwards
+	// in the units of lens files: radius, thickness and aperture diameter in mm
+	std::vector<LensInterface> doubleGauss() {
+		const float elements[][4] = {
+			{ -39.73f, 0.f, 1.f, 20.f }, { 437.065f, 3.22f, 1.717f, 20.f }, { -20.385f, 0.19f, 1.f, 20.f },
+			{ 40.77f, 6.065f, 1.658f, 20.f }, { -14.495f, 1.18f, 1.603f, 17.f }, { 0.f, 4.5f, 0.f, 17.1f },
+			{ 12.75f, 5.705f, 1.f, 18.f }, { 40.77f, 3.275f, 1.699f, 23.f }, { 19.275f, 4.025f, 1.67f, 23.f },
+			{ 84.83f, 0.12f, 1.f, 25.2f }, { 29.475f, 3.76f, 1.67f, 25.2f }
+		};
+		std::vector<LensInterface> interfaces;
+		for (const float* e : elements) {
+			LensInterface element;
+			element.curvature = 0.001f * e[0];
+			element.thickness = 0.001f * e[1];
+			element.eta = e[2];
+			element.aperture = 0.0005f * e[3];
+			interfaces.push_back(element);
+		}
+		return interfaces;
+	}
+
+	// Sphere over a ground quad with an emissive quad above, the meshes of a small interior
+	ScenePtr makeScene() {
+		MaterialPtr diffuse = MaterialPtr(new SurfaceMaterial(glm::vec3(0.7f), glm::vec3(0.f), 0.f, 0.f, 0.f, 1.f, 1.5f, false));
+		MaterialPtr light = MaterialPtr(new SurfaceMaterial(glm::vec3(0.f), glm::vec3(10.f), 0.f, 0.f, 0.f, 1.f, 1.5f, false));
+		std::vector<MeshPtr> meshes = {
+			Mesh::createSphere(glm::vec3(0.f, 1.f, 0.f), 1.f, 256, 512),
+			Mesh::createQuad(glm::vec3(-5.f, 0.f, -5.f), glm::vec3(0.f, 0.f, 10.f), glm::vec3(10.f, 0.f, 0.f)),
+			Mesh::createQuad(glm::vec3(-1.f, 4.f, -1.f), glm::vec3(2.f, 0.f, 0.f), glm::vec3(0.f, 0.f, 2.f))
+		};
+		meshes[0]->material = diffuse;
+		meshes[1]->material = diffuse;
+		meshes[2]->material = light;
+		std::unique_ptr<Camera> camera = std::unique_ptr<Camera>(new PerspectiveCamera(cameraToWorld(), RESOLUTION, 40.f, 0.01f, 100.f));
+		return Scene::create(meshes, std::move(camera));
+	}
+
+	std::vector<Ray> makeCameraRays(const Camera& camera) {
+		RandomSampler rng;
+		std::vector<Ray> rays(NUM_SAMPLES);
+		for (Ray& ray : rays) camera.createRay(ray, rng.next2D() * glm::vec2(RESOLUTION), rng.next2D());
+		return rays;
+	}
+
+	void createRays(size_t iterations, const Camera& camera) {
+		static const std::vector<glm::vec3> samples = makeSamples();
+		Ray ray;
+		for (size_t i = 0; i < iterations; i++) {
+			const glm::vec3& s = samples[i % NUM_SAMPLES];
+			Bench::doNotOptimize(camera.createRay(ray, glm::vec2(s.x * RESOLUTION.x, s.y * RESOLUTION.y), glm::vec2(s.z, s.x)));
+			Bench::doNotOptimize(ray);
+		}
+	}
+
+	// Creating a scene releases the previously active one, e.g. that of another
+	// benchmark, so the untimed setup call of every run builds it again
+	void intersect(size_t iterations, bool shadow) {
+		static ScenePtr scene;
+		static std::vector<Ray> rays;
+		if (iterations == 0 || !scene) {
+			scene = makeScene();
+			rays = makeCameraRays(*scene->getCamera());
+		}
+		Hit hit;
+		for (size_t i = 0; i < iterations; i++) {
+			const Ray& ray = rays[i % NUM_SAMPLES];
+			if (shadow) Bench::doNotOptimize(scene->shadowIntersect(ray));
+			else Bench::doNotOptimize(scene->intersect(ray, hit));
+		}
+	}
+}
+
+LYKTA_BENCHMARK(meshSample, "mesh/sample/131K") {
+	static const std::vector<glm::vec3> samples = makeSamples();
+	static const MeshPtr mesh = Mesh::createSphere(glm::vec3(0.f), 1.f, 256, 256);
+	MeshSample info;
+	for (size_t i = 0; i < iterations; i++) {
+		mesh->sample(samples[i % NUM_SAMPLES], info);
+		Bench::doNotOptimize(info);
+	}
+}
+
+LYKTA_BENCHMARK(cameraCreateRayPerspective, "camera/createRay/perspective") {
+	static const PerspectiveCamera camera = PerspectiveCamera(cameraToWorld(), RESOLUTION, 40.f, 0.01f, 100.f, 0.05f, 6.f);
+	createRays(iterations, camera);
+}
+
+LYKTA_BENCHMARK(cameraCreateRayRealistic, "camera/createRay/realistic") {
+	static const RealisticCamera camera = RealisticCamera(doubleGauss(), 0.f, cameraToWorld(), RESOLUTION);
+	createRays(iterations, camera);
+}
+
+// Rays from the sensor center towards the rear element, nearly all leave the lens
+LYKTA_BENCHMARK(cameraTraceRealistic, "camera/trace/realistic") {
+	static const RealisticCamera camera = RealisticCamera(doubleGauss(), 0.f, cameraToWorld(), RESOLUTION);
+	static const std::vector<glm::vec3> samples = makeSamples();
+	Ray out;
+	for (size_t i = 0; i < iterations; i++) {
+		const glm::vec3& s = samples[i % NUM_SAMPLES];
+		Ray in = Ray(glm::vec3(0.f), glm::normalize(glm::vec3((s.x - 0.5f) * 0.02f, (s.y - 0.5f) * 0.02f, 0.04f)));
+		Bench::doNotOptimize(camera.trace(in, out));
+		Bench::doNotOptimize(out);
+	}
+}
+
+LYKTA_BENCHMARK(sceneIntersect, "scene/intersect") {
+	intersect(iterations, false);
+}
+
+LYKTA_BENCHMARK(sceneShadowIntersect, "scene/shadowIntersect") {
+	intersect(iterations, true);
+}
@@ -0,0 +1,42 @@
+#include <cstdio>
+#include <cstdlib>
+#include "Benchmark.hpp"
+#include "Image.hpp"
+#include "random.h"
+
+using namespace Lykta;
+
+namespace {
+	const int IMAGE_SIZE = 1024;
+
+	const Image<glm::vec3>& image() {
+		static Image<glm::vec3> render = []() {
+			Image<glm::vec3> result(IMAGE_SIZE, IMAGE_SIZE);
+			RandomSampler rng;
+			for (int i = 0; i < IMAGE_SIZE * IMAGE_SIZE; i++) result[i] = rng.next3D() * 2.f;
+			return result;
+		}();
+		return render;
+	}
+
+	// One operation saves a whole 1024x1024 image to the temp directory
+	void save(size_t iterations, const std::string& extension) {
+		const char* dir = getenv("TMPDIR");
+		std::string path = std::string(dir ? dir : "/tmp") + "/lykta_bench." + extension;
+		const Image<glm::vec3>& render = image();
+		for (size_t i = 0; i < iterations; i++) render.save(path);
+		remove(path.c_str());
+	}
+}
+
+LYKTA_BENCHMARK(imageSavePNG, "image/save/png/1K") {
+	save(iterations, "png");
+}
+
+LYKTA_BENCHMARK(imageSaveEXR, "image/save/exr/1K") {
+	save(iterations, "exr");
+}
+
+LYKTA_BENCHMARK(imageSavePFM, "image/save/pfm/1K") {
+	save(iterations, "pfm");
+}
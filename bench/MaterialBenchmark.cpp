@@ -0,0 +1,105 @@
+#include "Benchmark.hpp"
+#include "Material.hpp"
+#include "random.h"
+
+using namespace Lykta;
+
+namespace {
+	const int NUM_POINTS = 4096;
+
+	// Shading points in structure of arrays layout, directions above and below the surface
+	struct ShadingPoints {
+		std::vector<float> wi[3], wo[3], sample[2];
+
+		ShadingPoints() {
+			RandomSampler rng;
+			for (int c = 0; c < 3; c++) {
+				wi[c].resize(NUM_POINTS);
+				wo[c].resize(NUM_POINTS);
+			}
+			sample[0].resize(NUM_POINTS);
+			sample[1].resize(NUM_POINTS);
+			for (int i = 0; i < NUM_POINTS; i++) {
+				glm::vec3 a = glm::normalize(rng.next3D() * 2.f - glm::vec3(1.f));
+				glm::vec3 b = glm::normalize(rng.next3D() * 2.f - glm::vec3(1.f));
+				a.z = fabsf(a.z);
+				for (int c = 0; c < 3; c++) {
+					wi[c][i] = a[c];
+					wo[c][i] = b[c];
+				}
+				sample[0][i] = rng.next();
+				sample[1][i] = rng.next();
+			}
+		}
+	};
+
+	const ShadingPoints& points() {
+		static const ShadingPoints p;
+		return p;
+	}
+
+	SurfaceMaterial makeMaterial() {
+		return SurfaceMaterial(glm::vec3(0.8f, 0.5f, 0.2f), glm::vec3(0.f), 0.5f, 0.2f, 0.f, 0.3f, 1.5f, false);
+	}
+
+	// Shades points begin to end one at a time
+	void shadeScalar(const SurfaceMaterial& material, const MaterialParameters& params, size_t begin, size_t end, bool sample) {
+		const ShadingPoints& p = points();
+		for (size_t n = begin; n < end; n++) {
+			int i = (int)(n % NUM_POINTS);
+			SurfaceInteraction si;
+			si.wi = glm::vec3(p.wi[0][i], p.wi[1][i], p.wi[2][i]);
+			si.wo = glm::vec3(p.wo[0][i], p.wo[1][i], p.wo[2][i]);
+			if (sample) Bench::doNotOptimize(material.sample(glm::vec2(p.sample[0][i], p.sample[1][i]), si, params));
+			else Bench::doNotOptimize(material.evaluate(si, params));
+			Bench::doNotOptimize(si.pdf);
+		}
+	}
+
+	void evalScalar(size_t iterations, bool sample) {
+		SurfaceMaterial material = makeMaterial();
+		MaterialParameters params = material.evalMaterialParameters(glm::vec2(0.f));
+		shadeScalar(material, params, 0, iterations, sample);
+	}
+
+	// Counts shading points, one iteration of the loop handles SIMD_WIDTH of them.
+	// The points after the last whole packet take the scalar path, so exactly
+	// iterations points are shaded.
+	void evalPacket(size_t iterations, bool sample) {
+		const ShadingPoints& p = points();
+		SurfaceMaterial material = makeMaterial();
+		MaterialParametersN params = material.evalMaterialParameters(Vec2N(glm::vec2(0.f)), MaskN(true));
+		size_t packetPoints = iterations - iterations % SIMD_WIDTH;
+		for (size_t n = 0; n < packetPoints; n += SIMD_WIDTH) {
+			int i = (int)(n % NUM_POINTS);
+			SurfaceInteractionN si;
+			si.wi = Vec3N(FloatN::load(&p.wi[0][i]), FloatN::load(&p.wi[1][i]), FloatN::load(&p.wi[2][i]));
+			si.wo = Vec3N(FloatN::load(&p.wo[0][i]), FloatN::load(&p.wo[1][i]), FloatN::load(&p.wo[2][i]));
+			Vec3N result;
+			if (sample) result = material.sample(Vec2N(FloatN::load(&p.sample[0][i]), FloatN::load(&p.sample[1][i])), si, params);
+			else result = material.evaluate(si, params);
+			Bench::doNotOptimize(result);
+			Bench::doNotOptimize(si.pdf);
+		}
+
+		if (packetPoints < iterations) {
+			shadeScalar(material, material.evalMaterialParameters(glm::vec2(0.f)), packetPoints, iterations, sample);
+		}
+	}
+}
+
+LYKTA_BENCHMARK(materialEvaluateScalar, "material/evaluate/scalar") {
+	evalScalar(iterations, false);
+}
+
+LYKTA_BENCHMARK(materialEvaluatePacket, "material/evaluate/packet") {
+	evalPacket(iterations, false);
+}
+
+LYKTA_BENCHMARK(materialSampleScalar, "material/sample/scalar") {
+	evalScalar(iterations, true);
+}
+
+LYKTA_BENCHMARK(materialSamplePacket, "material/sample/packet") {
+	evalPacket(iterations, true);
+}
@@ -0,0 +1,83 @@
+#include "Benchmark.hpp"
+#include "random.h"
+#include <omp.h>
+#include <atomic>
+#include <vector>
+
+using namespace Lykta;
+
+namespace {
+	// Reference for the previous implementation, packed per-thread samplers
+	// looked up with omp_get_thread_num on every draw
+	std::vector<RandomSampler> packedSamplers = std::vector<RandomSampler>(256);
+
+	inline float nextPacked() {
+		return packedSamplers[omp_get_thread_num()].next();
+	}
+
+	// Per-thread samplers padded to a cache line, so that states of different
+	// threads never share one. Every thread gets its own PCG stream and reseeds
+	// lazily when init has bumped the generation.
+	struct alignas(64) RandomThreadState {
+		RandomSampler sampler;
+		unsigned generation = 0;
+	};
+
+	std::atomic<unsigned> generation{ 0 };
+	std::atomic<unsigned> streams{ 0 };
+	thread_local RandomThreadState local;
+
+	void initThreadLocal() {
+		generation.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	inline float nextThreadLocal() {
+		RandomThreadState& state = local;
+		unsigned current = generation.load(std::memory_order_relaxed);
+		if (state.generation != current) {
+			state.sampler.seed(current, streams.fetch_add(1, std::memory_order_relaxed));
+			state.generation = current;
+		}
+		return state.sampler.next();
+	}
+
+	// Every thread draws its share of the iterations, ns/op is per random number
+	template <bool packed>
+	void drawNumbers(size_t iterations, int threads) {
+		long long count = (long long)(iterations / threads + 1);
+		initThreadLocal();
+
+		#pragma omp parallel num_threads(threads)
+		{
+			float sum = 0.f;
+			for (long long i = 0; i < count; i++) {
+				sum += packed ? nextPacked() : nextThreadLocal();
+			}
+			Bench::doNotOptimize(sum);
+		}
+	}
+}
+
+LYKTA_BENCHMARK(randomPacked1, "random/next1D/packed/1") {
+	drawNumbers<true>(iterations, 1);
+}
+
+LYKTA_BENCHMARK(randomThreadLocal1, "random/next1D/thread_local/1") {
+	drawNumbers<false>(iterations, 1);
+}
+
+LYKTA_BENCHMARK(randomPacked8, "random/next1D/packed/8") {
+	drawNumbers<true>(iterations, 8);
+}
+
+LYKTA_BENCHMARK(randomThreadLocal8, "random/next1D/thread_local/8") {
+	drawNumbers<false>(iterations, 8);
+}
+
+LYKTA_BENCHMARK(randomPacked64, "random/next1D/packed/64") {
+	drawNumbers<true>(iterations, 64);
+}
+
+LYKTA_BENCHMARK(randomThreadLocal64, "random/next1D/thread_local/64") {
+	drawNumbers<false>(iterations, 64);
+}
@@ -0,0 +1,34 @@
+#include "Benchmark.hpp"
+#include "Sampler.hpp"
+
+using namespace Lykta;
+
+namespace {
+	// One camera sample and two bounces worth of dimensions per pixel sample
+	void drawSamples(size_t iterations, Sampler::Type type) {
+		std::unique_ptr<Sampler> sampler = Sampler::create(type);
+		const int dimensionsPerPixel = 18;
+		for (size_t i = 0; i < iterations; i += dimensionsPerPixel / 2) {
+			sampler->startPixelSample(glm::ivec2((int)(i & 511), (int)(i >> 9) & 511), (uint32_t)(i >> 18));
+			for (int d = 0; d < dimensionsPerPixel / 2; d++) {
+				Bench::doNotOptimize(sampler->get2D());
+			}
+		}
+	}
+}
+
+LYKTA_BENCHMARK(samplerIndependent, "sampler/get2D/independent") {
+	drawSamples(iterations, Sampler::Type::INDEPENDENT);
+}
+
+LYKTA_BENCHMARK(samplerSobol, "sampler/get2D/sobol") {
+	drawSamples(iterations, Sampler::Type::SOBOL);
+}
+
+LYKTA_BENCHMARK(samplerPMJ02, "sampler/get2D/pmj02") {
+	drawSamples(iterations, Sampler::Type::PMJ02);
+}
+
+LYKTA_BENCHMARK(samplerBlueNoise, "sampler/get2D/bluenoise") {
+	drawSamples(iterations, Sampler::Type::BLUE_NOISE);
+}
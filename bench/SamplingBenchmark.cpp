@@ -0,0 +1,64 @@
+#include "Benchmark.hpp"
+#include "Sampling.hpp"
+#include "random.h"
+
+using namespace Lykta;
+
+namespace {
+	const int NUM_SAMPLES = 4096;
+
+	// Structure of arrays so that packets load straight from them
+	struct Samples {
+		std::vector<float> u, v;
+
+		Samples() : u(NUM_SAMPLES), v(NUM_SAMPLES) {
+			RandomSampler rng;
+			for (int i = 0; i < NUM_SAMPLES; i++) {
+				u[i] = rng.next();
+				v[i] = rng.next();
+			}
+		}
+	};
+
+	const Samples& samples() {
+		static const Samples s;
+		return s;
+	}
+
+	void sampleScalar(size_t iterations, bool ggx) {
+		const Samples& s = samples();
+		for (size_t n = 0; n < iterations; n++) {
+			int i = (int)(n % NUM_SAMPLES);
+			glm::vec2 sample = glm::vec2(s.u[i], s.v[i]);
+			if (ggx) Bench::doNotOptimize(Sampling::GGX(sample, 0.3f));
+			else Bench::doNotOptimize(Sampling::cosineHemisphere(sample));
+		}
+	}
+
+	// Counts directions, one iteration of the loop handles SIMD_WIDTH of them
+	void samplePacket(size_t iterations, bool ggx) {
+		const Samples& s = samples();
+		for (size_t n = 0; n < iterations; n += SIMD_WIDTH) {
+			int i = (int)(n % NUM_SAMPLES);
+			Vec2N sample = Vec2N(FloatN::load(&s.u[i]), FloatN::load(&s.v[i]));
+			if (ggx) Bench::doNotOptimize(Sampling::GGX(sample, FloatN(0.3f)));
+			else Bench::doNotOptimize(Sampling::cosineHemisphere(sample));
+		}
+	}
+}
+
+LYKTA_BENCHMARK(samplingCosineScalar, "sampling/cosineHemisphere/scalar") {
+	sampleScalar(iterations, false);
+}
+
+LYKTA_BENCHMARK(samplingCosinePacket, "sampling/cosineHemisphere/packet") {
+	samplePacket(iterations, false);
+}
+
+LYKTA_BENCHMARK(samplingGGXScalar, "sampling/GGX/scalar") {
+	sampleScalar(iterations, true);
+}
+
+LYKTA_BENCHMARK(samplingGGXPacket, "sampling/GGX/packet") {
+	samplePacket(iterations, true);
+}
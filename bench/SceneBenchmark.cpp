@@ -0,0 +1,215 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include "SceneBenchmark.hpp"
+#include "Renderer.hpp"
+#include "SceneGenerator.hpp"
+#include "ImageMetrics.hpp"
+#include "Statistics.hpp"
+
+using namespace Lykta;
+
+namespace {
+	struct Preset {
+		std::string name;
+		// Needs several gigabytes, only run with --heavy
+		bool heavy;
+		SceneGenerator::Settings settings;
+	};
+
+	std::vector<Preset> presets() {
+		std::vector<Preset> list;
+		auto add = [&list](const std::string& name, bool heavy) -> SceneGenerator::Settings& {
+			list.push_back({ name, heavy, SceneGenerator::Settings() });
+			return list.back().settings;
+		};
+
+		add("triangles/1K", false).triangles = 1000;
+		add("triangles/1M", false).triangles = 1000000;
+		add("triangles/10M", true).triangles = 10000000;
+		add("triangles/100M", true).triangles = 100000000;
+		add("emitters/1", false).emitters = 1;
+		add("emitters/100", false).emitters = 100;
+		add("emitters/10K", false).emitters = 10000;
+		add("foliage/100K", false).foliage = 100000;
+		add("foliage/1M", true).foliage = 1000000;
+		SceneGenerator::Settings& textured = add("textures/16x1K", false);
+		textured.textures = 16;
+		textured.textureSize = 1024;
+		add("environment/2K", false).environmentWidth = 2048;
+		add("environment/8K", true).environmentWidth = 8192;
+		return list;
+	}
+
+	struct Options {
+		std::string filter, jsonFile;
+		double budget = 10.0;
+		// Seconds of the reference render per scene, no error is measured if zero
+		double reference = 40.0;
+		bool heavy = false;
+	};
+
+	struct SceneResult {
+		std::string name;
+		size_t triangles = 0;
+		size_t emitters = 0;
+		double loadSeconds = 0.0;
+		double renderSeconds = 0.0;
+		int samples = 0;
+		double raysPerSecond = 0.0;
+		double peakMemoryMB = 0.0;
+		// Negative without a reference
+		double rmse = -1.0;
+	};
+
+	double secondsSince(const std::chrono::steady_clock::time_point& start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Restarts the peak resident set size measurement where the OS allows it
+	void resetPeakMemory() {
+#ifdef __linux__
+		std::ofstream clearRefs("/proc/self/clear_refs");
+		clearRefs << "5";
+#endif
+	}
+
+	// Peak resident set size since the last reset, or since the process started
+	double peakMemoryMB() {
+#ifdef __linux__
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line)) {
+			if (line.compare(0, 6, "VmHWM:") == 0) return atof(line.c_str() + 6) / 1024.0;
+		}
+#endif
+#ifndef _WIN32
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+		return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+		return usage.ru_maxrss / 1024.0;
+#endif
+#else
+		return 0.0;
+#endif
+	}
+
+	// Renders full frames until at least seconds have passed and returns the number of frames
+	int renderFor(Renderer& renderer, double seconds) {
+		auto start = std::chrono::steady_clock::now();
+		int frames = 0;
+		do {
+			renderer.renderFrame();
+			frames++;
+		} while (secondsSince(start) < seconds);
+		return frames;
+	}
+
+	SceneResult runPreset(const Preset& preset, const Options& options) {
+		SceneResult result;
+		result.name = preset.name;
+
+		// The previous scene must not count towards the peak of this one
+		Scene::releaseActiveScene();
+		resetPeakMemory();
+		Statistics::reset();
+
+		// Load time covers generation, the BVH build and the integrator preprocess
+		std::unique_ptr<Renderer> renderer = std::unique_ptr<Renderer>(new Renderer());
+		auto loadStart = std::chrono::steady_clock::now();
+		ScenePtr scene;
+		{
+			ScopedTimer timer(Statistics::SCENE_LOAD);
+			scene = SceneGenerator::generate(preset.settings);
+			renderer->setScene(scene);
+		}
+		result.loadSeconds = secondsSince(loadStart);
+		for (const MeshPtr& mesh : scene->getMeshes()) result.triangles += mesh->triangles.size();
+		result.emitters = scene->getEmitters().size();
+
+		auto renderStart = std::chrono::steady_clock::now();
+		result.samples = renderFor(*renderer, options.budget);
+		result.renderSeconds = secondsSince(renderStart);
+		Statistics::Report report = Statistics::collect();
+		uint64_t rays = report.counters[Statistics::PRIMARY_RAYS] + report.counters[Statistics::BOUNCE_RAYS]
+			+ report.counters[Statistics::SHADOW_RAYS];
+		result.raysPerSecond = rays / result.renderSeconds;
+		result.peakMemoryMB = peakMemoryMB();
+
+		// The reference is an independent render with another seed, its own noise
+		// adds to the error, so it should get several times the budget
+		if (options.reference > 0.0) {
+			Image<glm::vec3> image = renderer->getImage();
+			renderer->setSeed(0x9e3779b9u);
+			renderer->refresh();
+			renderFor(*renderer, options.reference);
+			result.rmse = ImageMetrics::rmse(image, renderer->getImage());
+		}
+
+		renderer.reset();
+		scene.reset();
+		Scene::releaseActiveScene();
+		return result;
+	}
+
+	bool writeJSON(const std::string& filename, const std::vector<SceneResult>& results, const Options& options) {
+		std::ofstream out(filename.c_str());
+		out << std::setprecision(9);
+		out << "{\n  \"budget\": " << options.budget << ",\n  \"reference\": " << options.reference << ",\n  \"scenes\": [\n";
+		for (size_t i = 0; i < results.size(); i++) {
+			const SceneResult& r = results[i];
+			out << "    { \"name\": \"" << r.name << "\", \"triangles\": " << r.triangles << ", \"emitters\": " << r.emitters
+				<< ", \"loadSeconds\": " << r.loadSeconds << ", \"renderSeconds\": " << r.renderSeconds
+				<< ", \"samples\": " << r.samples << ", \"raysPerSecond\": " << r.raysPerSecond
+				<< ", \"peakMemoryMB\": " << r.peakMemoryMB << ", \"rmse\": " << r.rmse << " }"
+				<< ((i + 1 < results.size()) ? "," : "") << "\n";
+		}
+		out << "  ]\n}\n";
+		return (bool)out;
+	}
+}
+
+int Bench::runSceneBenchmarks(int argc, char** argv) {
+	Options options;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--scenes") == 0) continue;
+		else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) options.budget = atof(argv[++i]);
+		else if (strcmp(argv[i], "--reference") == 0 && i + 1 < argc) options.reference = atof(argv[++i]);
+		else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) options.jsonFile = argv[++i];
+		else if (strcmp(argv[i], "--heavy") == 0) options.heavy = true;
+		else options.filter = argv[i];
+	}
+
+	std::cout << std::left << std::setw(20) << "scene" << std::right << std::setw(12) << "triangles" << std::setw(10) << "emitters"
+		<< std::setw(10) << "load s" << std::setw(8) << "spp" << std::setw(10) << "Mrays/s" << std::setw(10) << "peak MB"
+		<< std::setw(12) << "RMSE" << std::endl;
+
+	std::vector<SceneResult> results;
+	for (const Preset& preset : presets()) {
+		if (!options.filter.empty() && preset.name.find(options.filter) == std::string::npos) continue;
+		if (preset.heavy && !options.heavy) continue;
+
+		SceneResult r = runPreset(preset, options);
+		results.push_back(r);
+		std::cout << std::left << std::setw(20) << r.name << std::right << std::setw(12) << r.triangles << std::setw(10) << r.emitters
+			<< std::fixed << std::setprecision(2) << std::setw(10) << r.loadSeconds << std::setw(8) << r.samples
+			<< std::setw(10) << r.raysPerSecond * 1e-6 << std::setprecision(0) << std::setw(10) << r.peakMemoryMB;
+		if (r.rmse >= 0.0) std::cout << std::setprecision(5) << std::setw(12) << r.rmse;
+		else std::cout << std::setw(12) << "-";
+		std::cout << std::endl;
+	}
+
+	if (!options.jsonFile.empty() && !writeJSON(options.jsonFile, results, options)) {
+		std::cout << "Could not write results: " << options.jsonFile << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// End-to-end benchmarks of generated scenes, see runSceneBenchmarks in SceneBenchmark.cpp
+namespace Lykta {
+	namespace Bench {
+		// Usage: lykta_bench --scenes [filter] [--budget seconds] [--reference seconds] [--heavy] [--json results.json]
+		int runSceneBenchmarks(int argc, char** argv);
+	}
+}
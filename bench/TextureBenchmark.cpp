@@ -0,0 +1,105 @@
+#include "Benchmark.hpp"
+#include "Texture.hpp"
+#include "Material.hpp"
+#include "random.h"
+
+using namespace Lykta;
+
+namespace {
+	const int NUM_UVS = 4096;
+	const int TEXTURE_SIZE = 1024;
+
+	// Tiling coordinates far outside of [0, 1], as produced by UDIM-style layouts
+	std::vector<glm::vec2> makeUVs() {
+		RandomSampler rng;
+		std::vector<glm::vec2> uvs(NUM_UVS);
+		for (glm::vec2& uv : uvs) uv = rng.next2D() * 2000.f - glm::vec2(1000.f);
+		return uvs;
+	}
+
+	template <typename T>
+	TexturePtr<T> makeTexture(WrapMode wrap, FilterMode filter = FilterMode::NEAREST) {
+		ImagePtr<T> image = ImagePtr<T>(new Image<T>(TEXTURE_SIZE, TEXTURE_SIZE));
+		RandomSampler rng;
+		for (int i = 0; i < TEXTURE_SIZE * TEXTURE_SIZE; i++) (*image)[i] = T(rng.next());
+		return TexturePtr<T>(new Texture<T>(image, wrap, filter));
+	}
+
+	// Textures and materials are built once per benchmark as function-local statics,
+	// so that filling the image is not part of the timed body
+	template <typename T>
+	void evalTexture(size_t iterations, const Texture<T>& texture) {
+		static const std::vector<glm::vec2> uvs = makeUVs();
+		for (size_t i = 0; i < iterations; i++) {
+			Bench::doNotOptimize(texture.eval(uvs[i % NUM_UVS]));
+		}
+	}
+
+	void evalParameters(size_t iterations, const SurfaceMaterial& material) {
+		static const std::vector<glm::vec2> uvs = makeUVs();
+		for (size_t i = 0; i < iterations; i++) {
+			Bench::doNotOptimize(material.evalMaterialParameters(uvs[i % NUM_UVS]));
+		}
+	}
+}
+
+LYKTA_BENCHMARK(textureEvalRepeat, "texture/eval/repeat") {
+	static const TexturePtr<glm::vec3> texture = makeTexture<glm::vec3>(WrapMode::REPEAT);
+	evalTexture(iterations, *texture);
+}
+
+LYKTA_BENCHMARK(textureEvalClamp, "texture/eval/clamp") {
+	static const TexturePtr<glm::vec3> texture = makeTexture<glm::vec3>(WrapMode::CLAMP);
+	evalTexture(iterations, *texture);
+}
+
+LYKTA_BENCHMARK(textureEvalMirror, "texture/eval/mirror") {
+	static const TexturePtr<glm::vec3> texture = makeTexture<glm::vec3>(WrapMode::MIRROR);
+	evalTexture(iterations, *texture);
+}
+
+LYKTA_BENCHMARK(textureEvalBilinear, "texture/eval/bilinear") {
+	static const TexturePtr<glm::vec3> texture = makeTexture<glm::vec3>(WrapMode::REPEAT, FilterMode::BILINEAR);
+	evalTexture(iterations, *texture);
+}
+
+LYKTA_BENCHMARK(textureEvalBicubic, "texture/eval/bicubic") {
+	static const TexturePtr<glm::vec3> texture = makeTexture<glm::vec3>(WrapMode::REPEAT, FilterMode::BICUBIC);
+	evalTexture(iterations, *texture);
+}
+
+LYKTA_BENCHMARK(textureEvalFloatNearest, "texture/eval/float/nearest") {
+	static const TexturePtr<float> texture = makeTexture<float>(WrapMode::REPEAT);
+	evalTexture(iterations, *texture);
+}
+
+LYKTA_BENCHMARK(textureEvalFloatBilinear, "texture/eval/float/bilinear") {
+	static const TexturePtr<float> texture = makeTexture<float>(WrapMode::REPEAT, FilterMode::BILINEAR);
+	evalTexture(iterations, *texture);
+}
+
+LYKTA_BENCHMARK(textureEvalFloatBicubic, "texture/eval/float/bicubic") {
+	static const TexturePtr<float> texture = makeTexture<float>(WrapMode::REPEAT, FilterMode::BICUBIC);
+	evalTexture(iterations, *texture);
+}
+
+// Per-hit cost of parameter evaluation without textures
+LYKTA_BENCHMARK(materialParamsConstant, "material/evalMaterialParameters/constant") {
+	static const SurfaceMaterial material(glm::vec3(0.8f), glm::vec3(0.f), 0.5f, 0.f, 0.f, 0.3f, 1.5f, false);
+	evalParameters(iterations, material);
+}
+
+// Per-hit cost with all five shading textures, which share one texel lookup
+LYKTA_BENCHMARK(materialParamsTextured, "material/evalMaterialParameters/textured") {
+	static const SurfaceMaterial material(glm::vec3(0.8f), glm::vec3(0.f), 0.5f, 0.f, 0.f, 0.3f, 1.5f, false,
+		makeTexture<glm::vec3>(WrapMode::REPEAT), makeTexture<float>(WrapMode::REPEAT), makeTexture<float>(WrapMode::REPEAT),
+		makeTexture<float>(WrapMode::REPEAT), makeTexture<float>(WrapMode::REPEAT), nullptr);
+	evalParameters(iterations, material);
+}
+
+// Per-hit cost with only a diffuse texture, the common case for most assets
+LYKTA_BENCHMARK(materialParamsDiffuseTexture, "material/evalMaterialParameters/diffuse") {
+	static const SurfaceMaterial material(glm::vec3(0.8f), glm::vec3(0.f), 0.5f, 0.f, 0.f, 0.3f, 1.5f, false,
+		makeTexture<glm::vec3>(WrapMode::REPEAT), nullptr, nullptr, nullptr, nullptr, nullptr);
+	evalParameters(iterations, material);
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <cstring>
+#include <cstdlib>
+#include <rapidjson/rapidjson.h>
+#include <rapidjson/document.h>
+#include "Benchmark.hpp"
+#include "SceneBenchmark.hpp"
+#include "SIMD.hpp"
+
+using namespace Lykta;
+
+namespace {
+	// Results of an earlier --json run by name, empty if the file can't be read
+	std::map<std::string, double> readBaseline(const std::string& filename) {
+		std::map<std::string, double> nsPerOp;
+		std::ifstream in(filename.c_str());
+		std::stringstream sstr;
+		sstr << in.rdbuf();
+		rapidjson::Document document;
+		document.Parse(sstr.str().c_str());
+		if (!document.IsObject() || !document.HasMember("benchmarks") || !document["benchmarks"].IsArray()) {
+			std::cout << "Could not read baseline: " << filename << std::endl;
+			return nsPerOp;
+		}
+
+		const rapidjson::Value& benchmarks = document["benchmarks"];
+		for (rapidjson::SizeType i = 0; i < benchmarks.Size(); i++) {
+			const rapidjson::Value& b = benchmarks[i];
+			if (b.HasMember("name") && b["name"].IsString() && b.HasMember("nsPerOp") && b["nsPerOp"].IsNumber()) {
+				nsPerOp[b["name"].GetString()] = b["nsPerOp"].GetDouble();
+			}
+		}
+		return nsPerOp;
+	}
+
+	bool writeJSON(const std::string& filename, const std::vector<Bench::Result>& results, double minTime) {
+		std::ofstream out(filename.c_str());
+		out << std::setprecision(9);
+		out << "{\n  \"simdWidth\": " << SIMD_WIDTH << ",\n  \"minTime\": " << minTime << ",\n  \"benchmarks\": [\n";
+		for (size_t i = 0; i < results.size(); i++) {
+			const Bench::Result& r = results[i];
+			out << "    { \"name\": \"" << r.name << "\", \"iterations\": " << r.iterations << ", \"seconds\": " << r.seconds
+				<< ", \"nsPerOp\": " << r.nsPerOp() << ", \"opsPerSecond\": " << r.opsPerSecond() << " }"
+				<< ((i + 1 < results.size()) ? "," : "") << "\n";
+		}
+		out << "  ]\n}\n";
+		return (bool)out;
+	}
+}
+
+// Usage: lykta_bench [filter] [--min-time seconds] [--json results.json] [--baseline results.json]
+//        lykta_bench --scenes [filter] [--budget seconds] [--reference seconds] [--heavy] [--json results.json]
+int main(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--scenes") == 0) return Bench::runSceneBenchmarks(argc, argv);
+	}
+
+	std::string filter, jsonFile, baselineFile;
+	double minTime = 0.5;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) minTime = atof(argv[++i]);
+		else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) jsonFile = argv[++i];
+		else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baselineFile = argv[++i];
+		else filter = argv[i];
+	}
+
+	// Speedup over the baseline is shown for benchmarks that it contains
+	std::map<std::string, double> baseline;
+	if (!baselineFile.empty()) baseline = readBaseline(baselineFile);
+
+	std::cout << std::left << std::setw(44) << "benchmark" << std::right
+		<< std::setw(14) << "ns/op" << std::setw(16) << "ops/s";
+	if (!baselineFile.empty()) std::cout << std::setw(10) << "speedup";
+	std::cout << std::endl;
+
+	std::vector<Bench::Result> results;
+	for (const auto& benchmark : Bench::Registry::benchmarks()) {
+		if (!filter.empty() && benchmark.first.find(filter) == std::string::npos) continue;
+		Bench::Result result = Bench::run(benchmark.first, benchmark.second, minTime);
+		results.push_back(result);
+		std::cout << std::left << std::setw(44) << result.name << std::right << std::fixed
+			<< std::setprecision(2) << std::setw(14) << result.nsPerOp()
+			<< std::setprecision(0) << std::setw(16) << result.opsPerSecond();
+		auto it = baseline.find(result.name);
+		if (it != baseline.end()) std::cout << std::setprecision(2) << std::setw(9) << it->second / result.nsPerOp() << "x";
+		std::cout << std::endl;
+	}
+
+	if (!jsonFile.empty() && !writeJSON(jsonFile, results, minTime)) {
+		std::cout << "Could not write results: " << jsonFile << std::endl;
+	}
+
+	return 0;
+}
@@ -1,17 +1,23 @@
 #include "Integrator.hpp"
 #include "Sampling.hpp"
+#include "Statistics.hpp"
 
-glm::vec3 Lykta::AOIntegrator::evaluate(const Lykta::Ray& ray, const std::shared_ptr<Lykta::Scene> scene) {
+glm::vec3 Lykta::AOIntegrator::evaluate(const Lykta::Ray& ray, const std::shared_ptr<Lykta::Scene> scene, Lykta::Sampler& sampler, Lykta::AOVSample& aov) {
 	Lykta::Hit hit;
 	bool intersected = scene->intersect(ray, hit);
+	Lykta::Statistics::count(Lykta::Statistics::PRIMARY_RAYS);
     
 	if (!intersected) {
 		return glm::vec3(0.f);
 	}
 
+	const Lykta::MaterialPtr material = scene->getMaterial(hit.geomID);
+	aov.setSurface(material->evalAlbedo(material->evalMaterialParameters(hit.texcoord)), hit.normal, glm::length(hit.pos - ray.o));
+
 	Lykta::Basis basis = Lykta::Basis(hit.normal);
-	glm::vec3 out = basis.fromLocalSpace(Lykta::Sampling::cosineHemisphere(Lykta::RND::next2D()));
+	glm::vec3 out = basis.fromLocalSpace(Lykta::Sampling::cosineHemisphere(sampler.get2D()));
 	Ray occlusionRay = Lykta::Ray(hit.pos, out, glm::vec2(EPS, maxlen));
 	bool shadowed = scene->shadowIntersect(occlusionRay);
+	Lykta::Statistics::count(Lykta::Statistics::SHADOW_RAYS);
 	return glm::vec3((float)!shadowed);
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "common.h"
+
+namespace Lykta {
+
+	enum class AOVType {
+		ALBEDO = 0,
+		NORMAL = 1,
+		DEPTH = 2,
+		EMISSION = 3,
+		DIRECT = 4,
+		INDIRECT = 5,
+		LIGHTGROUP = 6
+	};
+
+	// Arbitrary output variable requested by the scene file.
+	// It is accumulated next to the beauty image during the same render.
+	struct AOV {
+		AOVType type;
+		std::string name;
+		int lightGroup;
+
+		AOV(AOVType t, const std::string& n, int group = -1) : type(t), name(n), lightGroup(group) {}
+
+		// Lighting AOVs are split up parts of the beauty image
+		bool isLighting() const {
+			return type == AOVType::EMISSION || type == AOVType::DIRECT || type == AOVType::INDIRECT || type == AOVType::LIGHTGROUP;
+		}
+
+		int numChannels() const {
+			return (type == AOVType::DEPTH) ? 1 : 3;
+		}
+
+		std::vector<std::string> channelNames() const {
+			if (type == AOVType::DEPTH) return { name + ".Z" };
+			return { name + ".R", name + ".G", name + ".B" };
+		}
+	};
+
+	// Output variables of one camera path, filled in by the integrators
+	struct AOVSample {
+		// First hit surface
+		glm::vec3 albedo;
+		glm::vec3 normal;
+		float depth;
+
+		// Light reaching the camera split by number of bounces
+		glm::vec3 emission;
+		glm::vec3 direct;
+		glm::vec3 indirect;
+
+		// Light reaching the camera split by light group
+		std::vector<glm::vec3> lightGroups;
+
+		AOVSample(size_t numLightGroups = 0) : lightGroups(numLightGroups) {
+			reset();
+		}
+
+		void reset() {
+			albedo = normal = glm::vec3(0.f);
+			depth = 0.f;
+			emission = direct = indirect = glm::vec3(0.f);
+			std::fill(lightGroups.begin(), lightGroups.end(), glm::vec3(0.f));
+		}
+
+		void setSurface(const glm::vec3& a, const glm::vec3& n, float d) {
+			albedo = a;
+			normal = n;
+			depth = d;
+		}
+
+		// bounces is the number of surface interactions between the camera and the emitter
+		void addLight(const glm::vec3& value, int lightGroup, unsigned bounces) {
+			if (bounces == 0) emission += value;
+			else if (bounces == 1) direct += value;
+			else indirect += value;
+
+			if (lightGroup >= 0 && lightGroup < (int)lightGroups.size()) lightGroups[lightGroup] += value;
+		}
+
+		glm::vec3 get(const AOV& aov) const {
+			switch (aov.type) {
+			case AOVType::ALBEDO: return albedo;
+			case AOVType::NORMAL: return normal;
+			case AOVType::DEPTH: return glm::vec3(depth);
+			case AOVType::EMISSION: return emission;
+			case AOVType::DIRECT: return direct;
+			case AOVType::INDIRECT: return indirect;
+			case AOVType::LIGHTGROUP: return lightGroups[aov.lightGroup];
+			}
+			return glm::vec3(0.f);
+		}
+	};
+}
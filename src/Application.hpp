@@ -9,22 +9,41 @@
 #include <nanogui/slider.h>
 #include <nanogui/label.h>
 #include "Renderer.hpp"
+#include "RenderThread.hpp"
+#include "DisplayTexture.hpp"
+#include "CameraController.hpp"
 
 namespace Lykta {
 
 	class Application : public nanogui::Screen {
 	private:
-		uint32_t texture = 0;
+		std::unique_ptr<DisplayTexture> texture;
 		std::unique_ptr<nanogui::GLShader> shader;
 		std::unique_ptr<Renderer> renderer;
+		// Declared after the renderer so that it stops before the renderer is destroyed
+		std::unique_ptr<RenderThread> renderThread;
 		nanogui::Window* window;
 		nanogui::ComboBox* integratorBox;
+		nanogui::ComboBox* samplerBox;
+
+		// Navigation state, kept on the GUI thread so that moving the camera never
+		// waits for the renderer
+		CameraController cameraController;
+		bool sceneOpen = false;
+		glm::ivec2 sceneResolution = glm::ivec2(1);
+
+		void moveCamera() {
+			glm::mat4 cameraToWorld = cameraController.getCameraToWorld();
+			renderThread->edit([this, cameraToWorld]() { renderer->setCameraToWorld(cameraToWorld); });
+		}
 		
 	public:
 		Application() : nanogui::Screen(Eigen::Vector2i(1024, 768), "lykta") {
 			
 			// Initialize renderer
 			renderer = std::unique_ptr<Renderer>(new Renderer());
+			renderer->setProgressive(true);
+			renderThread = std::unique_ptr<RenderThread>(new RenderThread(*renderer));
 			
 			// Initialize user interface
 			initializeGUI();
@@ -73,22 +92,31 @@ namespace Lykta {
 			shader->uploadAttrib("position", positions);
 
 			// Set up texture for drawing on screen
-			glGenTextures(1, &texture);
-			glBindTexture(GL_TEXTURE_2D, texture);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			texture = std::unique_ptr<DisplayTexture>(new DisplayTexture());
 
 			drawAll();
 			setVisible(true);
 		}
 
 		virtual ~Application() {
-			glDeleteTextures(1, &texture);
+			renderThread = nullptr;
+			texture = nullptr;
 		}
 
 		void changeIntegrator() {
-			renderer->changeIntegrator((Integrator::Type) integratorBox->selectedIndex());
-			renderer->refresh();
+			Integrator::Type type = (Integrator::Type) integratorBox->selectedIndex();
+			renderThread->edit([this, type]() {
+				renderer->changeIntegrator(type);
+				if (renderer->isSceneOpen()) renderer->refresh();
+			});
+		}
+
+		void changeSampler() {
+			Sampler::Type type = (Sampler::Type) samplerBox->selectedIndex();
+			renderThread->edit([this, type]() {
+				renderer->changeSampler(type);
+				if (renderer->isSceneOpen()) renderer->refresh();
+			});
 		}
 
 		void initializeGUI() {
@@ -103,37 +131,94 @@ namespace Lykta {
 				std::vector<std::pair<std::string, std::string> > filetypes;
 				filetypes.push_back(jsontype);
 				std::string filename = nanogui::file_dialog(filetypes, false);
-				renderer->openScene(filename);
-				glfwSetWindowSize(glfwWindow(), renderer->getResolution().x, renderer->getResolution().y);
+				Sampler::Type samplerType;
+				glm::ivec2 resolution;
+				glm::mat4 cameraToWorld;
+				float pivotDistance = -1.f;
+				renderThread->edit([&]() {
+					renderer->openScene(filename);
+					samplerType = renderer->getSamplerType();
+					resolution = renderer->getResolution();
+					sceneOpen = renderer->isSceneOpen();
+					if (sceneOpen) {
+						cameraToWorld = renderer->getCameraToWorld();
+						pivotDistance = renderer->pickDistance(glm::vec2(resolution / 2));
+					}
+				});
+				// Orbit around the surface in the image center
+				if (sceneOpen) cameraController = CameraController(cameraToWorld, (pivotDistance > 0.f) ? pivotDistance : 1.f);
+				sceneResolution = glm::max(resolution, glm::ivec2(1));
+				samplerBox->setSelectedIndex(samplerType);
+				glfwSetWindowSize(glfwWindow(), resolution.x, resolution.y);
 			});
 
 			nanogui::Button* saveButton = new nanogui::Button(window, "Save Render", 0x0000F239);
 			saveButton->setCallback([this]() {
-				std::pair<std::string, std::string> pngtype = std::pair<std::string, std::string>("png", "Image");
-				std::vector<std::pair<std::string, std::string> > filetypes;
-				filetypes.push_back(pngtype);
+				std::vector<std::pair<std::string, std::string> > filetypes = {
+					{ "png", "Image" }, { "exr", "OpenEXR" }, { "pfm", "Portable Float Map" }, { "hdr", "Radiance HDR" }
+				};
 				std::string filename = nanogui::file_dialog(filetypes, true);
-				renderer->getImage().save(filename);
+				renderThread->access([&]() { renderer->saveImage(filename); });
+			});
+
+			nanogui::Button* statisticsButton = new nanogui::Button(window, "Statistics");
+			statisticsButton->setCallback([this]() {
+				std::string statistics;
+				renderThread->access([&]() { statistics = renderer->getStatistics(); });
+				new nanogui::MessageDialog(this, nanogui::MessageDialog::Type::Information, "Statistics", statistics);
 			});
 
 			// Integrator box
 			new nanogui::Label(window, "Integrator", "sans-bold");
-			integratorBox = new nanogui::ComboBox(window, { "PT", "BSDF", "AO" });
+			integratorBox = new nanogui::ComboBox(window, { "PT", "BSDF", "AO", "Wavefront" });
 			integratorBox->setCallback([&](int) { changeIntegrator(); });
+
+			// Sampler box, entries follow Sampler::Type
+			new nanogui::Label(window, "Sampler", "sans-bold");
+			samplerBox = new nanogui::ComboBox(window, { "Independent", "Sobol", "PMJ02", "Blue noise" });
+			samplerBox->setSelectedIndex(renderer->getSamplerType());
+			samplerBox->setCallback([&](int) { changeSampler(); });
 			
 			performLayout(mNVGContext);
 		}
 
+		// Left drag orbits, right or middle drag pans and scrolling dollies
+		virtual bool mouseMotionEvent(const Eigen::Vector2i& p, const Eigen::Vector2i& rel, int button, int modifiers) {
+			if (nanogui::Screen::mouseMotionEvent(p, rel, button, modifiers)) return true;
+			if (!sceneOpen || button == 0) return false;
+
+			if (button & (1 << GLFW_MOUSE_BUTTON_LEFT)) {
+				const float radiansPerPixel = 0.005f;
+				cameraController.orbit(-rel.x() * radiansPerPixel, -rel.y() * radiansPerPixel);
+			}
+			else {
+				float scale = 1.f / sceneResolution.y;
+				cameraController.pan(-rel.x() * scale, rel.y() * scale);
+			}
+			moveCamera();
+			return true;
+		}
+
+		virtual bool scrollEvent(const Eigen::Vector2i& p, const Eigen::Vector2f& rel) {
+			if (nanogui::Screen::scrollEvent(p, rel)) return true;
+			if (!sceneOpen) return false;
+
+			cameraController.dolly(0.1f * rel.y());
+			moveCamera();
+			return true;
+		}
+
 		void drawContents() {
-			// Drawing function for the image. 
-			if (renderer->isSceneOpen()) renderer->renderFrame();
-			const glm::ivec2& resolution = renderer->getResolution();
+			// Drawing function for the image, passes are rendered by the render thread
+			// and only the tiles that changed are uploaded when a new one has finished
+			bool isNew;
+			const DisplayFrame* frame = renderThread->latestFrame(isNew);
+			if (!frame) return;
+			const glm::ivec2 resolution(frame->width, frame->height);
 
 			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, texture);
-			glPixelStorei(GL_UNPACK_ROW_LENGTH, resolution.x);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, resolution.x, resolution.y, 0, GL_RGB, GL_FLOAT, renderer->getImage().getData());
-			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+			texture->bind();
+			if (isNew) texture->upload(*frame);
 
 			glViewport(0, 0, mPixelRatio * resolution.x, mPixelRatio * resolution.y);
 			shader->bind();
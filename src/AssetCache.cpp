@@ -0,0 +1,138 @@
+#include "AssetCache.hpp"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "Trace.hpp"
+
+using namespace Lykta;
+
+namespace {
+	// Erases the entries that were not used by the scene before the current one
+	template <typename Map>
+	void dropUnused(Map& map, unsigned generation) {
+		for (auto it = map.begin(); it != map.end();) {
+			if (it->second.lastUse + 1 < generation) it = map.erase(it);
+			else ++it;
+		}
+	}
+}
+
+AssetCache::AssetCache() {
+	// Low build quality selects Embree's two-level structure, which rebuilds only
+	// the geometries that changed since the last commit
+	device = rtcNewDevice(NULL);
+	embreeScene = rtcNewScene(device);
+	rtcSetSceneFlags(embreeScene, RTC_SCENE_FLAG_DYNAMIC);
+	rtcSetSceneBuildQuality(embreeScene, RTC_BUILD_QUALITY_LOW);
+}
+
+AssetCache::~AssetCache() {
+	rtcReleaseScene(embreeScene);
+	rtcReleaseDevice(device);
+}
+
+AssetCache::FileStamp AssetCache::stamp(const std::string& path) {
+	FileStamp result;
+	struct stat info;
+	if (stat(path.c_str(), &info) == 0) {
+		result.modified = (int64_t)info.st_mtime;
+		result.size = (int64_t)info.st_size;
+	}
+	return result;
+}
+
+template <typename T>
+T& AssetCache::lookup(EntryMap<T>& map, const std::string& key, const std::string& path, const std::function<T()>& load) {
+	FileStamp current = stamp(path);
+	auto it = map.find(key);
+	if (it != map.end() && it->second.stamp == current) {
+		it->second.lastUse = generation;
+		usage.assetsReused++;
+		return it->second.value;
+	}
+
+	Entry<T>& entry = map[key];
+	entry.stamp = current;
+	entry.value = load();
+	entry.lastUse = generation;
+	usage.assetsLoaded++;
+	return entry.value;
+}
+
+void AssetCache::beginScene() {
+	generation++;
+	usage = Usage();
+	dropUnused(meshes, generation);
+	dropUnused(floatImages, generation);
+	dropUnused(vec3Images, generation);
+	dropUnused(vec4Images, generation);
+	dropUnused(environments, generation);
+}
+
+std::vector<MeshPtr> AssetCache::getMeshes(const std::string& filename) {
+	auto it = meshes.find(filename);
+	bool usedByScene = (it != meshes.end() && it->second.lastUse == generation);
+
+	std::vector<MeshPtr>& cached = lookup<std::vector<MeshPtr>>(meshes, filename, filename, [&filename]() {
+		return Mesh::openObj(filename);
+	});
+	if (!usedByScene) return cached;
+
+	std::vector<MeshPtr> copies;
+	for (const MeshPtr& mesh : cached) copies.push_back(MeshPtr(new Mesh(*mesh)));
+	return copies;
+}
+
+template <>
+AssetCache::EntryMap<ImagePtr<float>>& AssetCache::imageMap<float>() {
+	return floatImages;
+}
+
+template <>
+AssetCache::EntryMap<ImagePtr<glm::vec3>>& AssetCache::imageMap<glm::vec3>() {
+	return vec3Images;
+}
+
+template <>
+AssetCache::EntryMap<ImagePtr<glm::vec4>>& AssetCache::imageMap<glm::vec4>() {
+	return vec4Images;
+}
+
+template <typename T>
+ImagePtr<T> AssetCache::getImage(const std::string& filename) {
+	return lookup<ImagePtr<T>>(imageMap<T>(), filename, filename, [&filename]() {
+		return ImagePtr<T>(new Image<T>(filename));
+	});
+}
+
+template ImagePtr<float> AssetCache::getImage<float>(const std::string& filename);
+template ImagePtr<glm::vec3> AssetCache::getImage<glm::vec3>(const std::string& filename);
+template ImagePtr<glm::vec4> AssetCache::getImage<glm::vec4>(const std::string& filename);
+
+EmitterPtr AssetCache::getEnvironment(const std::string& filename, const std::string& parameters, const std::function<EmitterPtr()>& create) {
+	return lookup<EmitterPtr>(environments, filename + "|" + parameters, filename, create);
+}
+
+RTCScene AssetCache::commitScene(const std::vector<MeshPtr>& sceneMeshes, const std::function<RTCGeometry(const MeshPtr&)>& createGeometry) {
+	TraceScope trace("AssetCache::commitScene");
+	for (size_t i = 0; i < sceneMeshes.size(); i++) {
+		if (i < attached.size() && attached[i] == sceneMeshes[i]) {
+			usage.geometriesKept++;
+			continue;
+		}
+
+		if (i < attached.size()) rtcDetachGeometry(embreeScene, (unsigned)i);
+		RTCGeometry geometry = createGeometry(sceneMeshes[i]);
+		rtcAttachGeometryByID(embreeScene, geometry, (unsigned)i);
+		rtcReleaseGeometry(geometry);
+		usage.geometriesBuilt++;
+	}
+
+	for (size_t i = sceneMeshes.size(); i < attached.size(); i++) {
+		rtcDetachGeometry(embreeScene, (unsigned)i);
+	}
+
+	// The attached meshes own the vertex and index buffers Embree shares
+	attached = sceneMeshes;
+	rtcCommitScene(embreeScene);
+	return embreeScene;
+}
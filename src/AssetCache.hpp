@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <embree3/rtcore.h>
+#include "common.h"
+#include "Image.hpp"
+#include "Mesh.hpp"
+
+namespace Lykta {
+
+	// Keeps assets loaded between scenes that are rendered one after another in
+	// one process, e.g. the frames of an animation. Files are identified by path,
+	// modification time and size, so an asset is reloaded as soon as its file
+	// changes. Assets the previous scene did not use are dropped when the next
+	// scene starts loading.
+	//
+	// The cache also owns a two-level Embree scene. Meshes that are attached at the
+	// same index as in the previous scene keep their geometry and BVH, only new or
+	// changed meshes are built before the top level is recommitted.
+	class AssetCache {
+	public:
+		// What the latest scene loaded and reused
+		struct Usage {
+			int assetsLoaded = 0;
+			int assetsReused = 0;
+			int geometriesBuilt = 0;
+			int geometriesKept = 0;
+		};
+
+	private:
+		struct FileStamp {
+			int64_t modified = -1;
+			int64_t size = -1;
+
+			bool operator==(const FileStamp& other) const {
+				return modified == other.modified && size == other.size;
+			}
+		};
+
+		template <typename T>
+		struct Entry {
+			FileStamp stamp;
+			T value;
+			// Scene that last used the entry
+			unsigned lastUse = 0;
+		};
+
+		template <typename T>
+		using EntryMap = std::map<std::string, Entry<T>>;
+
+		unsigned generation = 0;
+		Usage usage;
+
+		EntryMap<std::vector<MeshPtr>> meshes;
+		EntryMap<ImagePtr<float>> floatImages;
+		EntryMap<ImagePtr<glm::vec3>> vec3Images;
+		EntryMap<ImagePtr<glm::vec4>> vec4Images;
+		EntryMap<EmitterPtr> environments;
+
+		RTCDevice device;
+		RTCScene embreeScene;
+		// Mesh of every geometry ID in the Embree scene
+		std::vector<MeshPtr> attached;
+
+		static FileStamp stamp(const std::string& path);
+
+		// Returns the cached value for key if its file is unchanged, otherwise loads it
+		template <typename T>
+		T& lookup(EntryMap<T>& map, const std::string& key, const std::string& path, const std::function<T()>& load);
+
+		template <typename T>
+		EntryMap<ImagePtr<T>>& imageMap();
+
+	public:
+		AssetCache();
+		~AssetCache();
+
+		AssetCache(const AssetCache&) = delete;
+		AssetCache& operator=(const AssetCache&) = delete;
+
+		// Starts a new scene and drops the assets the previous scene did not use
+		void beginScene();
+
+		// Meshes of an obj file. A file used twice in one scene gets copies, since
+		// every use assigns its own material.
+		std::vector<MeshPtr> getMeshes(const std::string& filename);
+
+		template <typename T>
+		ImagePtr<T> getImage(const std::string& filename);
+
+		// Environment emitter of a map file, parameters holds the other settings
+		// the emitter was created with
+		EmitterPtr getEnvironment(const std::string& filename, const std::string& parameters, const std::function<EmitterPtr()>& create);
+
+		RTCDevice getDevice() const {
+			return device;
+		}
+
+		// Makes meshes[i] geometry i of the Embree scene and commits it. Geometries
+		// that already hold the same mesh are kept, createGeometry builds the others.
+		RTCScene commitScene(const std::vector<MeshPtr>& meshes, const std::function<RTCGeometry(const MeshPtr&)>& createGeometry);
+
+		const Usage& getUsage() const {
+			return usage;
+		}
+	};
+}
@@ -1,9 +1,10 @@
 #include "Integrator.hpp"
 #include "Emitter.hpp"
+#include "Statistics.hpp"
 
 using namespace Lykta;
 
-glm::vec3 BSDFIntegrator::evaluate(const Ray& ray, const std::shared_ptr<Scene> scene) {
+glm::vec3 BSDFIntegrator::evaluate(const Ray& ray, const std::shared_ptr<Scene> scene, Sampler& sampler, AOVSample& aov) {
 	glm::vec3 result = glm::vec3(0.f);
 	glm::vec3 throughput = glm::vec3(1.f);
 	Ray r = ray;
@@ -11,26 +12,40 @@ glm::vec3 BSDFIntegrator::evaluate(const Ray& ray, const std::shared_ptr<Scene>
 
 	while (true) {
 		Lykta::Hit hit;
+		Statistics::count((bounces == 0) ? Statistics::PRIMARY_RAYS : Statistics::BOUNCE_RAYS);
 		if (!scene->intersect(r, hit)) {
 			EmitterPtr environmentMap = scene->getEnvironment();
 			if (environmentMap) {
 				EmitterInteraction ei;
 				ei.direction = r.d;
-				result += throughput * environmentMap->eval(ei);
+				glm::vec3 contribution = throughput * environmentMap->eval(ei);
+				result += contribution;
+				aov.addLight(contribution, environmentMap->getLightGroup(), bounces);
 			}
 			break;
 		}
 
 		const MaterialPtr material = scene->getMaterial(hit.geomID);
 
+		MaterialParameters params = material->evalMaterialParameters(hit.texcoord);
+
+		if (bounces == 0) {
+			aov.setSurface(material->evalAlbedo(params), hit.normal, glm::length(hit.pos - r.o));
+		}
+
 		if (maxComponent(material->getEmission()) > 0.f) {
-			result += throughput * material->getEmission();
+			glm::vec3 contribution = throughput * material->getEmission();
+			result += contribution;
+			aov.addLight(contribution, material->getLightGroup(), bounces);
 		}
 
 		// RR
-		float s = RND::next1D();
+		float s = sampler.get1D();
 		float success = fminf(0.75f, luminance(throughput));
-		if (s < (1 - success)) break;
+		if (s < (1 - success)) {
+			Statistics::count(Statistics::ROULETTE_TERMINATIONS);
+			break;
+		}
 		throughput /= success;
 
 		// Sample BSDF
@@ -40,8 +55,7 @@ glm::vec3 BSDFIntegrator::evaluate(const Ray& ray, const std::shared_ptr<Scene>
 		si.uv = hit.texcoord;
 		si.pos = hit.pos;
 		si.wi = glm::normalize(basis.toLocalSpace(-r.d));
-        MaterialParameters params = material->evalMaterialParameters(si.uv);
-		glm::vec3 color = material->sample(RND::next2D(), si, params);
+		glm::vec3 color = material->sample(sampler.get2D(), si, params);
 		glm::vec3 out = glm::normalize(basis.fromLocalSpace(si.wo));
 
 		throughput *= color;
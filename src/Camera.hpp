@@ -2,7 +2,7 @@
 
 #include "common.h"
 #include "Sampling.hpp"
-#include "RandomPool.hpp"
+#include "Sampler.hpp"
 #include <glm/vec2.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -34,22 +34,38 @@ namespace Lykta {
 		virtual glm::vec3 createRay(Ray& ray, const glm::vec2& pixel, const glm::vec2& sample) const = 0;
 
 
-		virtual void createRayBatch(std::vector<Ray>& rays, std::vector<glm::vec3>& colors)  const {
+		// Consumes sampler dimensions 0-3 of sampleIndex for every pixel
+		virtual void createRayBatch(std::vector<Ray>& rays, std::vector<glm::vec3>& colors, const Sampler& sampler, uint32_t sampleIndex) const {
 			rays.assign(resolution.x * resolution.y, Ray());
 			colors.assign(resolution.x * resolution.y, glm::vec3(0.f));
 
-			#pragma omp parallel for
-			for (int it = 0; it < resolution.x * resolution.y; it++) {
-				int i = it % resolution.x;
-				int j = it / resolution.x;
+			#pragma omp parallel
+			{
+				std::unique_ptr<Sampler> pixelSampler = sampler.clone();
 
-				glm::vec2 pixel = glm::vec2(i, j) + RND::next2D();
-				glm::vec2 sample = RND::next2D();
-				colors[it] = createRay(rays[it], pixel, sample);
+				#pragma omp for
+				for (int it = 0; it < resolution.x * resolution.y; it++) {
+					int i = it % resolution.x;
+					int j = it / resolution.x;
+
+					pixelSampler->startPixelSample(glm::ivec2(i, j), sampleIndex, 0);
+					glm::vec2 pixel = glm::vec2(i, j) + pixelSampler->get2D();
+					glm::vec2 sample = pixelSampler->get2D();
+					colors[it] = createRay(rays[it], pixel, sample);
+				}
 			}
 		}
 
 		virtual const glm::vec2 getResolution() const { return resolution; }
+
+		const glm::mat4& getCameraToWorld() const {
+			return cameraToWorld;
+		}
+
+		// Moves the camera, nothing else depends on its transform
+		void setCameraToWorld(const glm::mat4& m) {
+			cameraToWorld = m;
+		}
 	};
 
 	class PerspectiveCamera : public Camera {
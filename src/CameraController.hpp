@@ -0,0 +1,64 @@
+#pragma once
+
+#include "common.h"
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace Lykta {
+
+	// Orbit, pan and dolly navigation of a camera to world matrix where the camera
+	// looks along its z axis. Moves are applied to the existing matrix, so any
+	// handedness or scale of the scene's camera transform is kept.
+	class CameraController {
+	private:
+		glm::mat4 cameraToWorld;
+		// Distance from the camera to the point it orbits around
+		float pivotDistance;
+
+		glm::vec3 axis(int i) const {
+			return glm::normalize(glm::vec3(cameraToWorld[i]));
+		}
+
+	public:
+		CameraController(const glm::mat4& m = glm::mat4(), float distance = 1.f) : cameraToWorld(m), pivotDistance(distance) {}
+
+		const glm::mat4& getCameraToWorld() const {
+			return cameraToWorld;
+		}
+
+		glm::vec3 getPivot() const {
+			return glm::vec3(cameraToWorld[3]) + pivotDistance * axis(2);
+		}
+
+		// Rotates about the world y axis and the camera's x axis through the pivot,
+		// angles in radians. Pitch stops short of looking straight up or down.
+		void orbit(float yaw, float pitch) {
+			glm::vec3 pivot = getPivot();
+			glm::mat4 toPivot = glm::translate(glm::mat4(), pivot);
+			glm::mat4 fromPivot = glm::translate(glm::mat4(), -pivot);
+
+			// Pitch about the camera's x axis as it is after the yaw, so the camera does not roll
+			glm::mat4 rotation = glm::rotate(glm::mat4(), yaw, glm::vec3(0, 1, 0));
+			glm::vec3 right = glm::normalize(glm::vec3(rotation * glm::vec4(axis(0), 0)));
+			glm::mat4 pitched = glm::rotate(glm::mat4(), pitch, right) * rotation;
+			glm::vec3 forward = glm::normalize(glm::vec3(pitched * glm::vec4(axis(2), 0)));
+			if (fabsf(forward.y) < 0.99f) rotation = pitched;
+
+			cameraToWorld = toPivot * rotation * fromPivot * cameraToWorld;
+		}
+
+		// Moves camera and pivot in the image plane, in units of the pivot distance
+		void pan(float dx, float dy) {
+			glm::vec3 offset = pivotDistance * (dx * axis(0) + dy * axis(1));
+			cameraToWorld = glm::translate(glm::mat4(), offset) * cameraToWorld;
+		}
+
+		// Moves towards the pivot, each unit of amount shortens the distance by a factor e
+		void dolly(float amount) {
+			float distance = fmaxf(pivotDistance * expf(-amount), 1e-3f);
+			glm::vec3 offset = (pivotDistance - distance) * axis(2);
+			cameraToWorld = glm::translate(glm::mat4(), offset) * cameraToWorld;
+			pivotDistance = distance;
+		}
+	};
+}
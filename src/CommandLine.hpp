@@ -1,33 +1,273 @@
 #pragma once
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
 #include <filesystem/path.h>
 #include <filesystem/resolver.h>
 #include "Renderer.hpp"
+#include "ImageMetrics.hpp"
+#include "Trace.hpp"
 
 namespace Lykta {
 	class CommandLine {
 	private:
 		std::unique_ptr<Renderer> renderer;
+		// Keeps unchanged assets loaded between the scenes of a batch
+		std::shared_ptr<AssetCache> assets;
+
+		static bool parseIntegrator(const std::string& name, Integrator::Type& type) {
+			if (name == "pt") type = Integrator::Type::PT;
+			else if (name == "bsdf") type = Integrator::Type::BSDF;
+			else if (name == "ao") type = Integrator::Type::AO;
+			else if (name == "wavefront") type = Integrator::Type::WAVEFRONT;
+			else return false;
+			return true;
+		}
+
+		static bool parseSampler(const std::string& name, Sampler::Type& type) {
+			if (name == "independent") type = Sampler::Type::INDEPENDENT;
+			else if (name == "sobol") type = Sampler::Type::SOBOL;
+			else if (name == "pmj02") type = Sampler::Type::PMJ02;
+			else if (name == "bluenoise") type = Sampler::Type::BLUE_NOISE;
+			else return false;
+			return true;
+		}
+
+		// Splits a comma separated list, e.g. "pt,wavefront"
+		static std::vector<std::string> splitList(const std::string& list) {
+			std::vector<std::string> items;
+			std::stringstream sstr(list);
+			std::string item;
+			while (std::getline(sstr, item, ',')) {
+				if (!item.empty()) items.push_back(item);
+			}
+			return items;
+		}
+
+		// Replaces the first run of # in pattern with the zero padded number, e.g.
+		// shot.####.json with 12 gives shot.0012.json
+		static std::string substituteFrame(const std::string& pattern, int number) {
+			size_t start = pattern.find('#');
+			if (start == std::string::npos) return pattern;
+			size_t end = pattern.find_first_not_of('#', start);
+			if (end == std::string::npos) end = pattern.size();
+
+			std::string digits = std::to_string(number);
+			if (digits.size() < end - start) digits.insert(0, end - start - digits.size(), '0');
+			return pattern.substr(0, start) + digits + pattern.substr(end);
+		}
+
+		// Output file of one scene in a batch. Names without a # get the number
+		// inserted before the extension, so frames do not overwrite each other.
+		static std::string batchFile(const std::string& file, int number, bool batch) {
+			if (file.find('#') != std::string::npos) return substituteFrame(file, number);
+			if (!batch) return file;
+			size_t dot = file.find_last_of('.');
+			std::string stem = (dot == std::string::npos) ? file : file.substr(0, dot);
+			std::string ext = (dot == std::string::npos) ? "" : file.substr(dot);
+			return substituteFrame(stem + ".####" + ext, number);
+		}
+
+		// Path without the extension, e.g. scenes/box for scenes/box.json
+		static std::string stripExtension(const std::string& file) {
+			size_t dot = file.find_last_of('.');
+			size_t slash = file.find_last_of("/\\");
+			if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return file;
+			return file.substr(0, dot);
+		}
+
+		// 64-bit FNV-1a hash of the file contents and seed, zero if the file cannot be read
+		static uint64_t fileHash(const std::string& file, uint32_t seed) {
+			std::ifstream in(file.c_str(), std::ios::binary);
+			if (!in) return 0;
+			uint64_t h = 14695981039346656037ull;
+			char buffer[4096];
+			while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+				for (std::streamsize i = 0; i < in.gcount(); i++) {
+					h ^= (unsigned char)buffer[i];
+					h *= 1099511628211ull;
+				}
+			}
+			for (int i = 0; i < 4; i++) {
+				h ^= (seed >> (8 * i)) & 0xff;
+				h *= 1099511628211ull;
+			}
+			return h;
+		}
+
+		static void printUsage() {
+			std::cout << "Usage: lykta scene.json [samples] [-o output.png|.exr|.pfm|.hdr] [--denoise] [--seed n] [--first-sample n]\n"
+				<< "             [--integrator pt|bsdf|ao|wavefront] [--no-material-sort] [--stats statistics.json]\n"
+				<< "             [--trace trace.json]\n"
+				<< "       lykta scene.json [more.json ...] [--frames first-last] [options above]\n"
+				<< "       lykta scene.json [more.json ...] --convergence curves.csv [--budgets 1,2,4,8]\n"
+				<< "             [--integrators pt,bsdf,wavefront] [--samplers independent,sobol,pmj02,bluenoise]\n"
+				<< "             [--reference-samples n] [--rebuild-reference] [--seed n]" << std::endl;
+		}
+
 	public:
 
+		// Usage: lykta scene.json [samples] [-o output.png|.exr|.pfm|.hdr] [--denoise] [--seed n] [--first-sample n]
+		//        [--integrator pt|bsdf|ao|wavefront] [--no-material-sort] [--stats statistics.json]
+		//        [--trace trace.json]
+		//        lykta scene.json [more.json ...] [--frames first-last] [options above]
+		//        lykta scene.json [more.json ...] --convergence curves.csv [--budgets 1,2,4,8]
+		//        [--integrators pt,bsdf,wavefront] [--samplers independent,sobol,pmj02,bluenoise]
+		//        [--reference-samples n] [--rebuild-reference] [--seed n]
 		CommandLine(int argc, char** argv) {
 			renderer = std::unique_ptr<Renderer>(new Renderer());
 
-			char* sceneFile = argv[1];
+			std::string outputFile, statisticsFile, traceFile, convergenceFile;
+			std::vector<std::string> sceneFiles;
+			std::vector<std::string> integrators = { "pt", "bsdf", "wavefront" };
+			std::vector<std::string> samplers = { "independent", "sobol", "pmj02", "bluenoise" };
+			std::vector<double> budgets = { 1.0, 2.0, 4.0, 8.0 };
 			int samples = 128;
-			if (argc == 3) {
-				char* end;
-				samples = strtol(argv[2], &end, 10);
+			int referenceSamples = 1024;
+			int firstFrame = 0, lastFrame = -1;
+			uint32_t seed = 0;
+			bool denoise = false;
+			bool rebuildReference = false;
+			for (int i = 1; i < argc; i++) {
+				std::string arg = std::string(argv[i]);
+				if (arg == "-o" && i + 1 < argc) {
+					outputFile = std::string(argv[++i]);
+				}
+				else if (arg == "--denoise") {
+					denoise = true;
+				}
+				else if (arg == "--seed" && i + 1 < argc) {
+					seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+					renderer->setSeed(seed);
+				}
+				else if (arg == "--first-sample" && i + 1 < argc) {
+					renderer->setFirstSample((uint32_t)strtoul(argv[++i], nullptr, 10));
+				}
+				else if (arg == "--integrator" && i + 1 < argc) {
+					std::string name = std::string(argv[++i]);
+					Integrator::Type type = Integrator::Type::PT;
+					if (!parseIntegrator(name, type)) std::cout << "Unknown integrator " << name << ", using pt" << std::endl;
+					renderer->changeIntegrator(type);
+				}
+				else if (arg == "--no-material-sort") {
+					renderer->setMaterialSorting(false);
+				}
+				else if (arg == "--stats" && i + 1 < argc) {
+					statisticsFile = std::string(argv[++i]);
+				}
+				else if (arg == "--trace" && i + 1 < argc) {
+					traceFile = std::string(argv[++i]);
+				}
+				else if (arg == "--convergence" && i + 1 < argc) {
+					convergenceFile = std::string(argv[++i]);
+				}
+				else if (arg == "--budgets" && i + 1 < argc) {
+					budgets.clear();
+					for (const std::string& budget : splitList(argv[++i])) budgets.push_back(atof(budget.c_str()));
+				}
+				else if (arg == "--integrators" && i + 1 < argc) {
+					integrators = splitList(argv[++i]);
+				}
+				else if (arg == "--samplers" && i + 1 < argc) {
+					samplers = splitList(argv[++i]);
+				}
+				else if (arg == "--reference-samples" && i + 1 < argc) {
+					referenceSamples = strtol(argv[++i], nullptr, 10);
+				}
+				else if (arg == "--rebuild-reference") {
+					rebuildReference = true;
+				}
+				else if (arg == "--frames" && i + 1 < argc) {
+					// first-last or a single frame
+					char* end;
+					firstFrame = lastFrame = strtol(argv[++i], &end, 10);
+					if (*end == '-') lastFrame = strtol(end + 1, nullptr, 10);
+				}
+				else {
+					// A number is the sample count, anything else not starting with - a scene file
+					char* end;
+					long value = strtol(argv[i], &end, 10);
+					if (*end == '\0' && end != argv[i]) samples = (int)value;
+					else if (arg.size() > 1 && arg[0] == '-') {
+						std::cout << "Unknown option or missing value: " << arg << std::endl;
+						printUsage();
+						return;
+					}
+					else sceneFiles.push_back(arg);
+				}
+			}
+
+			if (sceneFiles.empty()) {
+				std::cout << "No scene file given!" << std::endl;
+				printUsage();
+				return;
+			}
+
+			renderer->setDenoising(denoise);
+			Trace::setEnabled(!traceFile.empty());
+
+			if (!convergenceFile.empty()) {
+				convergence(sceneFiles, convergenceFile, budgets, integrators, samplers, referenceSamples, seed, rebuildReference);
+			}
+			else {
+				// One scene per file and frame, # in a scene file is replaced by the frame number
+				std::vector<std::pair<std::string, int>> batch;
+				for (const std::string& sceneFile : sceneFiles) {
+					if (sceneFile.find('#') != std::string::npos) {
+						if (lastFrame < firstFrame) {
+							std::cout << "Scene pattern " << sceneFile << " needs a frame range, e.g. --frames 1-100" << std::endl;
+							return;
+						}
+						for (int frame = firstFrame; frame <= lastFrame; frame++) batch.push_back(std::make_pair(substituteFrame(sceneFile, frame), frame));
+					}
+					else batch.push_back(std::make_pair(sceneFile, (int)batch.size()));
+				}
+
+				// Scenes after the first reuse what did not change
+				bool isBatch = batch.size() > 1;
+				if (isBatch) assets = std::make_shared<AssetCache>();
+
+				for (size_t k = 0; k < batch.size(); k++) {
+					const std::string& sceneFile = batch[k].first;
+					int number = batch[k].second;
+					if (isBatch) std::cout << "Scene " << k + 1 << "/" << batch.size() << std::endl;
+					if (!std::ifstream(sceneFile.c_str()).good()) {
+						std::cout << "Scene file not found: " << sceneFile << std::endl;
+						continue;
+					}
+
+					// Default to a png next to the scene file
+					std::string output = batchFile(outputFile, number, isBatch);
+					if (outputFile.empty()) {
+						filesystem::path scenePath = filesystem::path(sceneFile);
+						std::string file = stripExtension(scenePath.filename());
+						file.append(".png");
+						filesystem::path folder = scenePath.parent_path();
+						filesystem::path image = filesystem::path(file);
+						filesystem::path imageFile = folder / image;
+						output = imageFile.str();
+					}
+
+					std::string statistics = (statisticsFile.empty()) ? "" : batchFile(statisticsFile, number, isBatch);
+					render(sceneFile, output, samples, statistics);
+				}
+			}
+
+			if (!traceFile.empty()) {
+				Trace::setEnabled(false);
+				if (Trace::write(traceFile)) std::cout << "Saved trace: " << traceFile << std::endl;
+				else std::cout << "Could not write trace: " << traceFile << std::endl;
 			}
-			
-			std::string filename = std::string(sceneFile);
-			render(filename, samples);
 		}
 
-		void render(const std::string& filename, int numSamples) {
+		// Renders and saves the image, then prints the statistics and writes them as JSON if statisticsFile is given
+		void render(const std::string& filename, const std::string& outputFile, int numSamples, const std::string& statisticsFile = "") {
 			std::cout << "Opening scene file: " << filename << std::endl;
-			renderer->openScene(filename);
+			renderer->openScene(filename, assets);
 			
 			std::cout << "Starting render..." << std::endl;
 			if (!renderer->isSceneOpen()) {
@@ -35,20 +275,145 @@ namespace Lykta {
 				return;
 			}
 
-			for (int i = 0; i < numSamples; i++) {
+			if (assets) {
+				const AssetCache::Usage& usage = assets->getUsage();
+				std::cout << "Reused " << usage.assetsReused << " of " << usage.assetsReused + usage.assetsLoaded << " assets, kept "
+					<< usage.geometriesKept << " of " << usage.geometriesKept + usage.geometriesBuilt << " BVH geometries" << std::endl;
+			}
+
+			for (int i = 0; i < numSamples - 1; i++) {
 				std::cout << "Rendering sample: " << i + 1 << "/" << numSamples << std::endl;
 				renderer->renderFrame();
 			}
 
-			filesystem::path scenePath = filesystem::path(filename);
-			std::string file = scenePath.filename();
-			file = file.substr(0, file.size() - 5);
-			file.append(".png");
-			filesystem::path folder = scenePath.parent_path();
-			filesystem::path image = filesystem::path(file);
-			filesystem::path imageFile = folder / image;
+			// Float formats are streamed to disk while the last sample renders, unless the
+			// image is denoised after the render or the AOVs need files of their own
+			std::unique_ptr<ImageWriter> writer = nullptr;
+			std::vector<std::string> channels = renderer->getChannelNames();
+			if (numSamples > 0 && !renderer->isDenoising() && ImageWriter::supportsChannels(outputFile, (int)channels.size())) {
+				const glm::ivec2& resolution = renderer->getResolution();
+				writer = ImageWriter::create(outputFile, resolution.x, resolution.y, channels);
+			}
+
+			if (numSamples > 0) {
+				std::cout << "Rendering sample: " << numSamples << "/" << numSamples << std::endl;
+				renderer->renderFrame(writer.get());
+			}
+
+			if (renderer->isDenoising()) {
+				std::cout << "Denoising..." << std::endl;
+				renderer->postprocess();
+			}
+
+			if (writer) {
+				ScopedTimer timer(Statistics::IMAGE_WRITE);
+				TraceScope trace("ImageWriter::close");
+				writer->close();
+			}
+			else renderer->saveImage(outputFile);
+
+			std::cout << "Saved image: " << outputFile << std::endl;
+			std::cout << renderer->getStatistics();
+
+			if (!statisticsFile.empty()) {
+				std::ofstream out(statisticsFile.c_str());
+				out << Statistics::collect().toJSON();
+				if (!out) std::cout << "Could not write statistics: " << statisticsFile << std::endl;
+			}
+		}
+
+		// Path traced reference of the open scene. It is cached next to the scene file as
+		// scene.reference<samples>-<hash>.pfm, where the hash covers the scene file and
+		// the seed, and only rendered if that file does not exist or rebuild is set.
+		// Changes to meshes or textures the scene loads are not detected.
+		Image<glm::vec3> convergenceReference(const std::string& sceneFile, int samples, uint32_t seed, bool rebuild) {
+			char hash[17];
+			snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)fileHash(sceneFile, seed));
+			std::string path = stripExtension(sceneFile) + ".reference" + std::to_string(samples) + "-" + hash + ".pfm";
+			if (!rebuild && std::ifstream(path.c_str()).good()) {
+				Image<glm::vec3> cached = Image<glm::vec3>(path);
+				if (cached.getDims() == renderer->getResolution()) {
+					std::cout << "Using reference: " << path << std::endl;
+					return cached;
+				}
+			}
+
+			// Another seed keeps the reference independent of the measured renders
+			std::cout << "Rendering reference with " << samples << " samples..." << std::endl;
+			renderer->changeIntegrator(Integrator::Type::PT);
+			renderer->setSeed(seed ^ 0x9e3779b9u);
+			renderer->refresh();
+			for (int i = 0; i < samples; i++) renderer->renderFrame();
+			renderer->getImage().save(path);
+			std::cout << "Saved reference: " << path << std::endl;
+			return renderer->getImage();
+		}
+
+		// Renders every scene with every integrator and sampler until each of the wall
+		// clock budgets and writes the error against the reference at those times as CSV.
+		// Only the time spent in renderFrame counts, the images are not denoised.
+		void convergence(const std::vector<std::string>& sceneFiles, const std::string& csvFile, std::vector<double> budgets,
+			const std::vector<std::string>& integrators, const std::vector<std::string>& samplers, int referenceSamples, uint32_t seed,
+			bool rebuildReference) {
+			std::ofstream csv(csvFile.c_str());
+			if (!csv) {
+				std::cout << "Could not write convergence curves: " << csvFile << std::endl;
+				return;
+			}
+			csv << "scene,integrator,sampler,budget,seconds,samples,relMSE,rmse\n";
+			std::sort(budgets.begin(), budgets.end());
+
+			for (const std::string& sceneFile : sceneFiles) {
+				std::cout << "Opening scene file: " << sceneFile << std::endl;
+				renderer->openScene(sceneFile);
+				if (!renderer->isSceneOpen()) {
+					std::cout << "Scene failed to open!" << std::endl;
+					continue;
+				}
+				Image<glm::vec3> reference = convergenceReference(sceneFile, referenceSamples, seed, rebuildReference);
+
+				for (const std::string& integratorName : integrators) {
+					Integrator::Type integratorType;
+					if (!parseIntegrator(integratorName, integratorType)) {
+						std::cout << "Unknown integrator " << integratorName << ", skipped" << std::endl;
+						continue;
+					}
+
+					for (const std::string& samplerName : samplers) {
+						Sampler::Type samplerType;
+						if (!parseSampler(samplerName, samplerType)) {
+							std::cout << "Unknown sampler " << samplerName << ", skipped" << std::endl;
+							continue;
+						}
+
+						renderer->changeIntegrator(integratorType);
+						renderer->changeSampler(samplerType);
+						renderer->setSeed(seed);
+						renderer->refresh();
+
+						double seconds = 0.0;
+						int samples = 0;
+						for (double budget : budgets) {
+							while (seconds < budget) {
+								auto start = std::chrono::steady_clock::now();
+								renderer->renderFrame();
+								seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+								samples++;
+							}
+
+							double relMSE = ImageMetrics::relMSE(renderer->getImage(), reference);
+							double rmse = ImageMetrics::rmse(renderer->getImage(), reference);
+							csv << sceneFile << "," << integratorName << "," << samplerName << "," << budget << "," << seconds
+								<< "," << samples << "," << relMSE << "," << rmse << "\n";
+							std::cout << integratorName << " " << samplerName << " " << budget << "s: " << samples
+								<< " samples, relMSE " << relMSE << std::endl;
+						}
+					}
+				}
+			}
 
-			renderer->getImage().save(imageFile.str());
+			if (!csv) std::cout << "Could not write convergence curves: " << csvFile << std::endl;
+			else std::cout << "Saved convergence curves: " << csvFile << std::endl;
 		}
 
 
@@ -0,0 +1,126 @@
+#include "Denoiser.hpp"
+#include "common.h"
+#include <vector>
+
+using namespace Lykta;
+
+// Albedo below this is treated as white so that black surfaces keep their color
+#define MIN_ALBEDO 1e-3f
+
+void Denoiser::denoise(Image<glm::vec3>& image, const Image<glm::vec3>& albedo, const Image<glm::vec3>& normal) const {
+	glm::ivec2 dims = image.getDims();
+	int numPixels = dims.x * dims.y;
+
+	// Demodulate albedo
+	std::vector<glm::vec3> illumination = std::vector<glm::vec3>(numPixels);
+	std::vector<glm::vec3> demodulation = std::vector<glm::vec3>(numPixels);
+	#pragma omp parallel for
+	for (int i = 0; i < numPixels; i++) {
+		glm::vec3 a = albedo[i];
+		demodulation[i] = glm::vec3(a.x > MIN_ALBEDO ? a.x : 1.f, a.y > MIN_ALBEDO ? a.y : 1.f, a.z > MIN_ALBEDO ? a.z : 1.f);
+		illumination[i] = image[i] / demodulation[i];
+	}
+
+	// Unit normals of the guide, accumulated normals of partly covered pixels are
+	// shorter than one. Zero length means background.
+	std::vector<glm::vec3> normals = std::vector<glm::vec3>(numPixels);
+	#pragma omp parallel for
+	for (int i = 0; i < numPixels; i++) {
+		float length2 = glm::dot(normal[i], normal[i]);
+		normals[i] = (length2 > 1e-12f) ? normal[i] / sqrtf(length2) : glm::vec3(0.f);
+	}
+
+	// Spatial luminance variance in a 3x3 window steers the edge-stopping function
+	std::vector<float> variance = std::vector<float>(numPixels);
+	#pragma omp parallel for
+	for (int y = 0; y < dims.y; y++) {
+		for (int x = 0; x < dims.x; x++) {
+			float sum = 0.f, sum2 = 0.f;
+			int count = 0;
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					int qx = x + dx, qy = y + dy;
+					if (qx < 0 || qy < 0 || qx >= dims.x || qy >= dims.y) continue;
+					float l = luminance(illumination[qy * dims.x + qx]);
+					sum += l;
+					sum2 += l * l;
+					count++;
+				}
+			}
+			float mean = sum / count;
+			variance[y * dims.x + x] = fmaxf(sum2 / count - mean * mean, 0.f);
+		}
+	}
+
+	// B3 spline kernel
+	const float kernel[3] = { 3.f / 8.f, 1.f / 4.f, 1.f / 16.f };
+
+	std::vector<glm::vec3> filtered = std::vector<glm::vec3>(numPixels);
+	std::vector<float> filteredVariance = std::vector<float>(numPixels);
+
+	for (int iteration = 0; iteration < iterations; iteration++) {
+		int step = 1 << iteration;
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int y = 0; y < dims.y; y++) {
+			for (int x = 0; x < dims.x; x++) {
+				int p = y * dims.x + x;
+				const glm::vec3& cp = illumination[p];
+				const glm::vec3& np = normals[p];
+				const glm::vec3& ap = albedo[p];
+				float lp = luminance(cp);
+				float sigma = sigmaLuminance * sqrtf(variance[p]) + EPS;
+				bool hasNormal = glm::dot(np, np) > 0.f;
+
+				glm::vec3 color = glm::vec3(0.f);
+				float var = 0.f, weightSum = 0.f;
+
+				for (int dy = -2; dy <= 2; dy++) {
+					int qy = y + dy * step;
+					if (qy < 0 || qy >= dims.y) continue;
+
+					for (int dx = -2; dx <= 2; dx++) {
+						int qx = x + dx * step;
+						if (qx < 0 || qx >= dims.x) continue;
+
+						int q = qy * dims.x + qx;
+						const glm::vec3& nq = normals[q];
+
+						// Surfaces and background are never mixed
+						float wn;
+						if (hasNormal) wn = powf(fmaxf(0.f, glm::dot(np, nq)), sigmaNormal);
+						else wn = (glm::dot(nq, nq) > 0.f) ? 0.f : 1.f;
+
+						glm::vec3 da = ap - albedo[q];
+						float wa = expf(-glm::dot(da, da) / (sigmaAlbedo * sigmaAlbedo));
+						float wl = expf(-fabsf(lp - luminance(illumination[q])) / sigma);
+
+						float w = kernel[abs(dx)] * kernel[abs(dy)] * wn * wa * wl;
+						color += w * illumination[q];
+						var += w * w * variance[q];
+						weightSum += w;
+					}
+				}
+
+				// All weights can underflow, e.g. next to very different albedos
+				if (weightSum > 0.f) {
+					filtered[p] = color / weightSum;
+					filteredVariance[p] = var / (weightSum * weightSum);
+				}
+				else {
+					filtered[p] = illumination[p];
+					filteredVariance[p] = variance[p];
+				}
+			}
+		}
+
+		illumination.swap(filtered);
+		variance.swap(filteredVariance);
+	}
+
+	// Remodulate albedo
+	#pragma omp parallel for
+	for (int i = 0; i < numPixels; i++) {
+		image[i] = illumination[i] * demodulation[i];
+	}
+}
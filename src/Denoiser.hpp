@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include "Image.hpp"
+
+namespace Lykta {
+
+	// Edge-avoiding a-trous wavelet filter guided by first hit albedo and normal.
+	// The image is divided by the albedo so that texture detail is kept while the
+	// illumination is filtered, and the filter strength follows the local variance
+	// of the illumination (Dammertz et al. 2010, Schied et al. 2017).
+	class Denoiser {
+	private:
+		int iterations;
+		float sigmaLuminance;
+		float sigmaNormal;
+		float sigmaAlbedo;
+
+	public:
+		Denoiser(int iter = 5, float sigmaL = 4.f, float sigmaN = 128.f, float sigmaA = 0.1f)
+			: iterations(iter), sigmaLuminance(sigmaL), sigmaNormal(sigmaN), sigmaAlbedo(sigmaA) {}
+
+		// Filters image in place, albedo and normal must have the same resolution
+		void denoise(Image<glm::vec3>& image, const Image<glm::vec3>& albedo, const Image<glm::vec3>& normal) const;
+	};
+}
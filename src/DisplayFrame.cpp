@@ -0,0 +1,128 @@
+#include "DisplayFrame.hpp"
+#include <cstring>
+#include "Hash.hpp"
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace Lykta;
+
+// Round to nearest even without tables (Giesen, float_to_half_fast3_rtne)
+uint16_t Lykta::floatToHalf(float value) {
+	uint32_t f;
+	memcpy(&f, &value, sizeof(float));
+	uint32_t sign = f & 0x80000000u;
+	f ^= sign;
+
+	const uint32_t f32Infinity = 255u << 23;
+	const uint32_t f16Max = (127u + 16u) << 23;
+	const uint32_t denormMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+	uint16_t half;
+	if (f >= f16Max) {
+		// Infinity stays infinity, NaN becomes a quiet NaN
+		half = (f > f32Infinity) ? 0x7e00 : 0x7c00;
+	}
+	else if (f < (113u << 23)) {
+		// Denormals, the float addition does the rounding
+		float magic, sum;
+		memcpy(&magic, &denormMagic, sizeof(float));
+		memcpy(&sum, &f, sizeof(float));
+		sum += magic;
+		uint32_t bits;
+		memcpy(&bits, &sum, sizeof(float));
+		half = (uint16_t)(bits - denormMagic);
+	}
+	else {
+		uint32_t mantissaOdd = (f >> 13) & 1;
+		f += ((uint32_t)(15 - 127) << 23) + 0xfff;
+		f += mantissaOdd;
+		half = (uint16_t)(f >> 13);
+	}
+	return half | (uint16_t)(sign >> 16);
+}
+
+#if !defined(__F16C__) && defined(__SSE2__)
+namespace {
+	// Four lanes of floatToHalf, returns the halves in the low 64 bits
+	inline __m128i floatToHalf4(__m128 value) {
+		const __m128i f32Infinity = _mm_set1_epi32(255 << 23);
+		const __m128i f16Max = _mm_set1_epi32((127 + 16) << 23);
+		const __m128i denormMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+		const __m128i normalMin = _mm_set1_epi32(113 << 23);
+
+		__m128i f = _mm_castps_si128(value);
+		__m128i sign = _mm_and_si128(f, _mm_set1_epi32(0x80000000));
+		f = _mm_xor_si128(f, sign);
+
+		__m128i overflow = _mm_cmpgt_epi32(f16Max, _mm_sub_epi32(f, _mm_set1_epi32(1)));
+		__m128i special = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(_mm_cmpgt_epi32(f, f32Infinity), _mm_set1_epi32(0x0200)));
+
+		__m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(f), _mm_castsi128_ps(denormMagic))), denormMagic);
+
+		__m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(f, 13), _mm_set1_epi32(1));
+		__m128i normal = _mm_add_epi32(f, _mm_set1_epi32((int)(((uint32_t)(15 - 127) << 23) + 0xfff)));
+		normal = _mm_srli_epi32(_mm_add_epi32(normal, mantissaOdd), 13);
+
+		__m128i isDenormal = _mm_cmpgt_epi32(normalMin, f);
+		__m128i finite = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+		__m128i result = _mm_or_si128(_mm_and_si128(overflow, finite), _mm_andnot_si128(overflow, special));
+		result = _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+
+		// Sign extend so that the saturating pack keeps the bits
+		result = _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+		return _mm_packs_epi32(result, result);
+	}
+}
+#endif
+
+void DisplayFrame::convert(const Image<glm::vec3>& image) {
+	glm::ivec2 dims = image.getDims();
+	width = dims.x;
+	height = dims.y;
+	pixels.resize((size_t)width * height * 4);
+	glm::ivec2 tiles = getTiles();
+	tileHashes.resize((size_t)tiles.x * tiles.y);
+
+	// Bands of one tile row are converted row by row, so that reads and writes
+	// stream through memory, while the hashes of all tiles in the band are updated
+	#pragma omp parallel for schedule(dynamic)
+	for (int ty = 0; ty < tiles.y; ty++) {
+		// 64-bit FNV-1a style hash with one RGBA half pixel per step, four
+		// interleaved chains per tile so the multiplies overlap
+		std::vector<uint64_t> h(tiles.x * 4, 14695981039346656037ull);
+		int y0 = ty * TILE_SIZE, y1 = std::min(y0 + TILE_SIZE, height);
+		for (int j = y0; j < y1; j++) {
+			const glm::vec3* in = image.getData() + (size_t)j * width;
+			uint16_t* out = &pixels[(size_t)j * width * 4];
+			for (int i = 0; i < width; i++) {
+				const glm::vec3& c = in[i];
+#if defined(__F16C__)
+				__m128i converted = _mm_cvtps_ph(_mm_setr_ps(c.x, c.y, c.z, 1.f), _MM_FROUND_TO_NEAREST_INT);
+				_mm_storel_epi64((__m128i*)(out + i * 4), converted);
+				uint64_t word = (uint64_t)_mm_cvtsi128_si64(converted);
+#elif defined(__SSE2__)
+				__m128i converted = floatToHalf4(_mm_setr_ps(c.x, c.y, c.z, 1.f));
+				_mm_storel_epi64((__m128i*)(out + i * 4), converted);
+				uint64_t word = (uint64_t)_mm_cvtsi128_si64(converted);
+#else
+				out[i * 4 + 0] = floatToHalf(c.x);
+				out[i * 4 + 1] = floatToHalf(c.y);
+				out[i * 4 + 2] = floatToHalf(c.z);
+				out[i * 4 + 3] = 0x3c00;
+				uint64_t word;
+				memcpy(&word, out + i * 4, sizeof(uint64_t));
+#endif
+				uint64_t& chain = h[(i / TILE_SIZE) * 4 + (i & 3)];
+				chain = (chain ^ word) * 1099511628211ull;
+			}
+		}
+		for (int tx = 0; tx < tiles.x; tx++) {
+			const uint64_t* chains = &h[tx * 4];
+			tileHashes[ty * tiles.x + tx] = hashInts(chains[0], chains[1], chains[2], chains[3]);
+		}
+	}
+}
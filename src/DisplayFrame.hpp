@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include "Image.hpp"
+
+namespace Lykta {
+
+	// Rendered image converted for display as RGBA half floats, which the GPU
+	// samples directly and which is two thirds of the size of RGB floats. Every
+	// tile has a hash, so that only tiles that changed since the last upload
+	// have to be transferred.
+	struct DisplayFrame {
+		static const int TILE_SIZE = 64;
+
+		int width = 0, height = 0;
+		std::vector<uint16_t> pixels;
+		std::vector<uint64_t> tileHashes;
+
+		glm::ivec2 getTiles() const {
+			return glm::ivec2((width + TILE_SIZE - 1) / TILE_SIZE, (height + TILE_SIZE - 1) / TILE_SIZE);
+		}
+
+		// Converts and hashes tiles in parallel
+		void convert(const Image<glm::vec3>& image);
+	};
+
+	// Rounds to the nearest half float, overflow becomes infinity
+	uint16_t floatToHalf(float value);
+}
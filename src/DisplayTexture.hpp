@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+#include <nanogui/opengl.h>
+#include "DisplayFrame.hpp"
+
+namespace Lykta {
+
+	// Texture that shows display frames. Storage is allocated once per
+	// resolution, afterwards only the tiles whose hash differs from the last
+	// upload are copied into a pixel buffer object and transferred with
+	// glTexSubImage2D. The two buffers alternate and are orphaned before they are
+	// mapped, so the copy never waits for a transfer that is still in flight.
+	class DisplayTexture {
+	private:
+		// Rectangle of dirty tiles packed tightly at offset bytes into the buffer
+		struct Span {
+			int x, y, width, height;
+			size_t offset;
+		};
+
+		GLuint texture = 0;
+		GLuint buffers[2] = { 0, 0 };
+		int nextBuffer = 0;
+		int width = 0, height = 0;
+		// Tile hashes of the texture contents, empty when they are unknown
+		std::vector<uint64_t> uploadedHashes;
+		std::vector<Span> spans;
+
+		void addSpan(int x, int y, int w, int h, size_t& size) {
+			// Full width spans of consecutive tile rows are one upload
+			if (!spans.empty() && w == width && x == 0) {
+				Span& last = spans.back();
+				if (last.width == width && last.y + last.height == y) {
+					last.height += h;
+					size += (size_t)w * h * 4 * sizeof(uint16_t);
+					return;
+				}
+			}
+			spans.push_back({ x, y, w, h, size });
+			size += (size_t)w * h * 4 * sizeof(uint16_t);
+		}
+
+	public:
+		DisplayTexture() {
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glGenBuffers(2, buffers);
+		}
+
+		~DisplayTexture() {
+			glDeleteBuffers(2, buffers);
+			glDeleteTextures(1, &texture);
+		}
+
+		void bind() const {
+			glBindTexture(GL_TEXTURE_2D, texture);
+		}
+
+		// Uploads the tiles of frame that changed, expects the texture to be bound
+		void upload(const DisplayFrame& frame) {
+			if (frame.width != width || frame.height != height) {
+				width = frame.width;
+				height = frame.height;
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+				uploadedHashes.clear();
+			}
+
+			// Merge consecutive dirty tiles of a tile row into spans
+			const int tileSize = DisplayFrame::TILE_SIZE;
+			glm::ivec2 tiles = frame.getTiles();
+			bool allDirty = uploadedHashes.size() != frame.tileHashes.size();
+			spans.clear();
+			size_t size = 0;
+			for (int ty = 0; ty < tiles.y; ty++) {
+				int y = ty * tileSize, h = std::min(tileSize, height - y);
+				int start = -1;
+				for (int tx = 0; tx <= tiles.x; tx++) {
+					int t = ty * tiles.x + tx;
+					bool dirty = tx < tiles.x && (allDirty || uploadedHashes[t] != frame.tileHashes[t]);
+					if (dirty && start < 0) start = tx;
+					if (!dirty && start >= 0) {
+						int x = start * tileSize;
+						addSpan(x, y, std::min(tx * tileSize, width) - x, h, size);
+						start = -1;
+					}
+				}
+			}
+			if (spans.empty()) return;
+
+			GLuint buffer = buffers[nextBuffer];
+			nextBuffer = 1 - nextBuffer;
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+			uint8_t* mapped = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			if (!mapped) {
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				return;
+			}
+
+			const size_t pixelSize = 4 * sizeof(uint16_t);
+			for (const Span& span : spans) {
+				for (int j = 0; j < span.height; j++) {
+					memcpy(mapped + span.offset + (size_t)j * span.width * pixelSize,
+						&frame.pixels[((size_t)(span.y + j) * width + span.x) * 4],
+						span.width * pixelSize);
+				}
+			}
+
+			// The contents are undefined if the buffer was lost while mapped
+			if (!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				uploadedHashes.clear();
+				return;
+			}
+
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 8);
+			for (const Span& span : spans) {
+				glTexSubImage2D(GL_TEXTURE_2D, 0, span.x, span.y, span.width, span.height,
+					GL_RGBA, GL_HALF_FLOAT, (const void*)span.offset);
+			}
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			uploadedHashes = frame.tileHashes;
+		}
+	};
+}
@@ -0,0 +1,74 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include "Distribution.hpp"
+#include "MappedFile.hpp"
+
+using namespace Lykta;
+
+namespace {
+	const char CACHE_MAGIC[8] = { 'L', 'Y', 'K', 'D', 'I', 'S', 'T', '1' };
+
+	struct CacheHeader {
+		char magic[8];
+		uint64_t key;
+		int32_t width;
+		int32_t height;
+		int32_t binSize;
+		int32_t padding;
+	};
+}
+
+bool Distribution2D::save(const std::string& path, uint64_t key) const {
+	if (!conditional) return false;
+
+	CacheHeader header;
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.key = key;
+	header.width = width;
+	header.height = height;
+	header.binSize = sizeof(AliasBin);
+	header.padding = 0;
+
+	// Write next to the target and rename, so concurrent renders never map a partial file
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%08x.tmp", (unsigned)std::random_device()());
+	std::string tempPath = path + suffix;
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) return false;
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)conditional, sizeof(AliasBin) * ((size_t)width * height + height));
+		if (!out.good()) {
+			out.close();
+			remove(tempPath.c_str());
+			return false;
+		}
+	}
+
+	if (rename(tempPath.c_str(), path.c_str()) != 0) {
+		remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool Distribution2D::load(const std::string& path, uint64_t key, int w, int h) {
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(path);
+	if (!file->isOpen()) return false;
+
+	size_t numBins = (size_t)w * h + h;
+	if (file->getSize() != sizeof(CacheHeader) + sizeof(AliasBin) * numBins) return false;
+
+	const CacheHeader* header = (const CacheHeader*)file->getData();
+	if (memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header->key != key ||
+		header->width != w || header->height != h || header->binSize != (int32_t)sizeof(AliasBin)) {
+		return false;
+	}
+
+	width = w;
+	height = h;
+	setBins(file, (const AliasBin*)(header + 1));
+	return true;
+}
@@ -2,91 +2,204 @@
 
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <string>
+#include <stdint.h>
 #include "common.h"
 #include "Texture.hpp"
 
 namespace Lykta {
-	
-	class Distribution1D {
+
+	// One entry of an alias table (Vose 1991). Every bin holds the probability of
+	// keeping its own index and the index it forwards to otherwise, so a sample is
+	// one multiply, one compare and one load.
+	struct AliasBin {
+		float q;
+		int alias;
+		float pdf;
+	};
+
+	// Samples index in [0, n) from the alias table starting at bins.
+	// r in [0, 1), the integer part selects a bin and the fraction decides alias or not.
+	inline int sampleAlias(const AliasBin* bins, int n, float r, float& pdf) {
+		float x = r * n;
+		int i = std::min((int)x, n - 1);
+		const AliasBin& bin = bins[i];
+		int idx = (x - i < bin.q) ? i : bin.alias;
+		pdf = bins[idx].pdf;
+		return idx;
+	}
+
+	// Builds alias tables in place. The scratch buffers are kept between calls so
+	// that building many rows does not allocate per row.
+	class AliasTableBuilder {
 	private:
-		std::vector<float> cdf;
+		std::vector<double> scaled;
+		std::vector<int> small, large;
 
 	public:
+		// Fills n bins from unnormalized weights and returns the weight sum.
+		// A zero sum gives a uniform table.
+		float build(const float* weights, int n, AliasBin* bins, bool parallel = false) {
+			// Partial sums over fixed blocks keep the total independent of the thread count
+			const int blockSize = 65536;
+			int numBlocks = (n + blockSize - 1) / blockSize;
+			std::vector<double> blockSums(numBlocks, 0.0);
+			#pragma omp parallel for if(parallel && numBlocks > 1)
+			for (int b = 0; b < numBlocks; b++) {
+				int end = std::min(n, (b + 1) * blockSize);
+				for (int i = b * blockSize; i < end; i++) {
+					blockSums[b] += weights[i];
+				}
+			}
+			double total = 0.0;
+			for (double blockSum : blockSums) total += blockSum;
+
+			// Scaled probabilities, 1 is the average bin
+			scaled.resize(n);
+			#pragma omp parallel for if(parallel && n > 65536)
+			for (int i = 0; i < n; i++) {
+				scaled[i] = (total > 0.0) ? weights[i] * n / total : 1.0;
+				bins[i].pdf = (float)(scaled[i] / n);
+				bins[i].alias = i;
+			}
 
-		// Build CDF distribution
-		Distribution1D(const std::vector<float>& pdf) {
-			cdf = std::vector<float>(pdf.size());
-
-			cdf[0] = pdf[0];
-			for (int i = 1; i < pdf.size(); i++) {
-				cdf[i] = pdf[i] + cdf[i - 1];
+			small.clear();
+			large.clear();
+			for (int i = 0; i < n; i++) {
+				if (scaled[i] < 1.0) small.push_back(i);
+				else large.push_back(i);
 			}
 
-			// normalize
-			for (int i = 0; i < cdf.size(); i++) {
-				cdf[i] /= cdf[cdf.size() - 1];
+			// Pair each underfull bin with an overfull one
+			while (!small.empty() && !large.empty()) {
+				int s = small.back(), l = large.back();
+				small.pop_back();
+				bins[s].q = (float)scaled[s];
+				bins[s].alias = l;
+
+				scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+				if (scaled[l] < 1.0) {
+					large.pop_back();
+					small.push_back(l);
+				}
 			}
+
+			// Leftovers are full up to rounding
+			for (int i : large) bins[i].q = 1.f;
+			for (int i : small) bins[i].q = 1.f;
+
+			return (float)total;
+		}
+	};
+
+	// Discrete distribution sampled in constant time with an alias table
+	class Distribution1D {
+	private:
+		std::vector<AliasBin> bins;
+		float sum = 0.f;
+
+	public:
+
+		// Build alias table, weights do not need to be normalized
+		Distribution1D(const std::vector<float>& weights) {
+			if (weights.empty()) return;
+			bins = std::vector<AliasBin>(weights.size());
+			AliasTableBuilder builder;
+			sum = builder.build(weights.data(), (int)weights.size(), bins.data(), true);
 		}
 
 		Distribution1D() {}
 		~Distribution1D() {}
 
+		int size() const {
+			return (int)bins.size();
+		}
+
+		// Sum of the weights the distribution was built from
+		float getSum() const {
+			return sum;
+		}
+
 		inline float pdf(int index) const {
-			if (index == 0) return cdf[0];
-			return cdf[index] - cdf[index - 1];
+			return bins[index].pdf;
 		}
 
-		// binary search correct index
 		int sample(float r, float& pdf) const {
-			int idx = cdf.size();
-			auto it = std::lower_bound(cdf.begin(), cdf.end(), r);
-			if (it != cdf.end()) idx = std::distance(cdf.begin(), it);
-			return idx;
+			return sampleAlias(bins.data(), (int)bins.size(), r, pdf);
 		}
 
 	};
 
+	// Piecewise constant distribution over an image. The alias tables of all rows
+	// and the marginal table over rows live in one contiguous buffer: row j starts
+	// at j * width and the marginal table follows the last row. The buffer is either
+	// owned or a read-only mapping of a cache file, copies share it.
 	class Distribution2D {
 	private:
-		std::vector<Distribution1D> widthDistributions;
-		Distribution1D heightDistribution;
+		int width = 0, height = 0;
+		std::shared_ptr<const void> storage;
+		const AliasBin* conditional = nullptr;
+		const AliasBin* marginal = nullptr;
+
+		void setBins(std::shared_ptr<const void> data, const AliasBin* bins) {
+			storage = data;
+			conditional = bins;
+			marginal = bins + (size_t)width * height;
+		}
 
 	public:
 
-		// Build distributions
-		Distribution2D(const std::vector<std::vector<float>>& image) {
-			assert(image.size() > 0);
-			std::vector<float> widthSums = std::vector<float>(image.size(), 0.f);
-			widthDistributions = std::vector<Distribution1D>(image.size());
-
-			#pragma omp parallel for
-			for (int j = 0; j < image.size(); j++) {
-				for (int i = 0; i < image[0].size(); i++) {
-					widthSums[j] += image[j][i];
+		// Build distributions from weight(i, j) for column i and row j. Rows are
+		// built in parallel straight into the flat buffer, each thread only keeps
+		// one row of weights.
+		template <typename F>
+		Distribution2D(int w, int h, const F& weight) : width(w), height(h) {
+			assert(w > 0 && h > 0);
+			std::shared_ptr<std::vector<AliasBin>> bins = std::make_shared<std::vector<AliasBin>>((size_t)w * h + h);
+			AliasBin* data = bins->data();
+			std::vector<float> rowSums = std::vector<float>(h);
+
+			#pragma omp parallel
+			{
+				AliasTableBuilder builder;
+				std::vector<float> row = std::vector<float>(w);
+
+				#pragma omp for schedule(dynamic, 16)
+				for (int j = 0; j < h; j++) {
+					for (int i = 0; i < w; i++) {
+						row[i] = weight(i, j);
+					}
+					rowSums[j] = builder.build(row.data(), w, data + (size_t)j * w);
 				}
-
-				widthDistributions[j] = Distribution1D(image[j]);
 			}
 
-			heightDistribution = Distribution1D(widthSums);
+			AliasTableBuilder builder;
+			builder.build(rowSums.data(), h, data + (size_t)w * h, true);
+			setBins(bins, data);
 		}
 
 		Distribution2D() {}
 		~Distribution2D() {}
 
+		// Cache files hold a small header with key and dimensions followed by the
+		// bins. Loading maps the file instead of reading it. Both return false on failure.
+		bool save(const std::string& path, uint64_t key) const;
+		bool load(const std::string& path, uint64_t key, int w, int h);
+
 		float pdf(const glm::ivec2& index) const {
-			float colpdf = heightDistribution.pdf(index.y);
-			float rowpdf = widthDistributions[index.y].pdf(index.x);
+			float colpdf = marginal[index.y].pdf;
+			float rowpdf = conditional[(size_t)index.y * width + index.x].pdf;
 			return colpdf * rowpdf;
 		}
 
 		glm::ivec2 sample(const glm::vec2& sample, float& pdf) const {
 			float colpdf, rowpdf;
-			int rowselect = heightDistribution.sample(sample.y, colpdf);
-			int colselect = widthDistributions[rowselect].sample(sample.x, rowpdf);
+			int rowselect = sampleAlias(marginal, height, sample.y, colpdf);
+			int colselect = sampleAlias(conditional + (size_t)rowselect * width, width, sample.x, rowpdf);
 			pdf = colpdf * rowpdf;
 			return glm::ivec2(colselect, rowselect);
 		}
 	};
 
-}
\ No newline at end of file
+}
@@ -36,8 +36,20 @@ namespace Lykta {
 	};
 
 	class Emitter {
+	protected:
+		int lightGroup = -1;
+
 	public:
 		virtual ~Emitter() {}
+
+		int getLightGroup() const {
+			return lightGroup;
+		}
+
+		void setLightGroup(int group) {
+			lightGroup = group;
+		}
+
 		virtual glm::vec3 eval(EmitterInteraction& ei) const = 0;
 		virtual glm::vec3 sample(const glm::vec3& s, EmitterInteraction& ei) const = 0;
 	};
@@ -56,22 +68,33 @@ namespace Lykta {
 
 	};
 
+	// Layout of the environment map image
+	enum class EnvironmentMapping {
+		LATLONG = 0,
+		// Equal-area octahedral map (Clarberg 2008), y is the pole
+		OCTAHEDRAL = 1
+	};
+
 	class EnvironmentEmitter : public Emitter {
 	private:
 		TexturePtr<glm::vec3> map;
 		Distribution2D samplingDistribution;
+		EnvironmentMapping mapping;
 		glm::ivec2 dims;
 		float intensity;
 		float rotation;
+		float rotSin, rotCos;
 
 		glm::vec2 dir2uv(const glm::vec3& dir) const;
 		glm::vec3 uv2dir(const glm::vec2& uv) const;
 		glm::vec2 uv2img(const glm::vec2& uv) const;
 		glm::vec2 img2uv(const glm::vec2& img) const;
 		inline glm::vec3 rotateDir(const glm::vec3& dir) const;
+		inline glm::vec3 inverseRotateDir(const glm::vec3& dir) const;
+		float pdfSolidAngle(float pdfImage, const glm::vec3& dir) const;
 	
 	public:
-		EnvironmentEmitter(TexturePtr<glm::vec3> m, float intens = 1.f, float rot = 0.f);
+		EnvironmentEmitter(TexturePtr<glm::vec3> m, float intens = 1.f, float rot = 0.f, EnvironmentMapping mapType = EnvironmentMapping::LATLONG);
 		EnvironmentEmitter() {}
 		~EnvironmentEmitter() {}
 
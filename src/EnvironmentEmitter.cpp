@@ -1,60 +1,114 @@
 #include "Emitter.hpp"
 #include "Sampling.hpp"
+#include "FastMath.hpp"
+#include "Statistics.hpp"
+#include "Trace.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
 
 using namespace Lykta;
 
-EnvironmentEmitter::EnvironmentEmitter(TexturePtr<glm::vec3> m, float intens, float rot) {
+// The sampling distribution only depends on the pixels of the map, rotation is
+// applied to directions afterwards. LYKTA_CACHE_DIR overrides the temp directory,
+// setting it to an empty string disables the cache.
+static std::string distributionCacheDir() {
+	const char* dir = getenv("LYKTA_CACHE_DIR");
+	if (dir) return std::string(dir);
+#ifdef _WIN32
+	dir = getenv("TEMP");
+	return dir ? std::string(dir) : std::string(".");
+#else
+	dir = getenv("TMPDIR");
+	return dir ? std::string(dir) : std::string("/tmp");
+#endif
+}
+
+EnvironmentEmitter::EnvironmentEmitter(TexturePtr<glm::vec3> m, float intens, float rot, EnvironmentMapping mapType) {
 	map = m;
 	intensity = intens;
 	rotation = rot;
+	mapping = mapType;
+
+	// The rotation is constant, only its sine and cosine are needed per direction
+	float angle = M_PI/2 + rotation;
+	rotSin = sin(angle);
+	rotCos = cos(angle);
 
-	// Construct image for CDF
+	// Construct distribution directly from the image, or map it from the cache
+	ScopedTimer timer(Statistics::CDF_BUILD);
+	TraceScope trace("environment CDF build");
 	ImagePtr<glm::vec3> img = m->getImage();
 	dims = img->getDims();
-	std::vector<std::vector<float>> distr;
-	distr.assign(dims.y, std::vector<float>(dims.x));
-
-	#pragma omp parallel for
-	for (int j = 0; j < dims.y; j++) {
-		float theta = M_PI * (j + 0.5f) / dims.y;
-		float sinTheta = sin(theta);
-
-		// It doesn't matter if we apply sinTheta to whole row or just the column distribution
-		// As everything is normalized later anyways.
-		for (int i = 0; i < dims.x; i++) {
-			distr[j][i] = sinTheta * luminance(img->read(glm::ivec2(i, j)));
-			distr[j][i] = fmaxf(distr[j][i], EPS);
+
+	std::string cacheFile;
+	uint64_t key = 0;
+	std::string cacheDir = distributionCacheDir();
+	if (!cacheDir.empty()) {
+		key = img->hash();
+		if (mapping == EnvironmentMapping::OCTAHEDRAL) key ^= 0x9e3779b97f4a7c15ull;
+		char name[64];
+		snprintf(name, sizeof(name), "lykta_env_%016llx.dist", (unsigned long long)key);
+		cacheFile = cacheDir + "/" + name;
+		if (samplingDistribution.load(cacheFile, key, dims.x, dims.y)) return;
+	}
+
+	// Equal-area pixels need no weighting, latlong rows shrink with sinTheta
+	std::vector<float> rowWeights = std::vector<float>(dims.y, 1.f);
+	if (mapping == EnvironmentMapping::LATLONG) {
+		for (int j = 0; j < dims.y; j++) {
+			rowWeights[j] = sin(M_PI * (j + 0.5f) / dims.y);
 		}
 	}
 
-	// Construct distribution
-	samplingDistribution = Distribution2D(distr);
+	// It doesn't matter if we apply sinTheta to whole row or just the column distribution
+	// As everything is normalized later anyways.
+	samplingDistribution = Distribution2D(dims.x, dims.y, [&](int i, int j) {
+		return fmaxf(rowWeights[j] * luminance(img->read(glm::ivec2(i, j))), EPS);
+	});
+
+	if (!cacheFile.empty() && !samplingDistribution.save(cacheFile, key)) {
+		std::cout << "Could not write environment cache: " << cacheFile << std::endl;
+	}
 }
 
+// World to map space
 inline glm::vec3 EnvironmentEmitter::rotateDir(const glm::vec3& dir) const {
-	float angle = M_PI/2 + rotation;
-	float s = sin(angle);
-	float c = cos(angle);
-	return glm::vec3(c * dir.x - s * dir.z, dir.y, s * dir.x + c * dir.z);
+	return glm::vec3(rotCos * dir.x - rotSin * dir.z, dir.y, rotSin * dir.x + rotCos * dir.z);
+}
+
+// Map to world space
+inline glm::vec3 EnvironmentEmitter::inverseRotateDir(const glm::vec3& dir) const {
+	return glm::vec3(rotCos * dir.x + rotSin * dir.z, dir.y, -rotSin * dir.x + rotCos * dir.z);
 }
 
 glm::vec2 EnvironmentEmitter::dir2uv(const glm::vec3& dir) const {
 	glm::vec3 d = rotateDir(dir);
-	float theta = std::acos(d.y);
-	float phi = std::atan2(d.z, d.x) + M_PI;
+	if (mapping == EnvironmentMapping::OCTAHEDRAL) {
+		// y is the pole of the octahedron
+		return Sampling::equalAreaSphereToSquare(glm::vec3(d.x, d.z, d.y));
+	}
+
+	float theta = FastMath::acos(clamp(d.y, -1.f, 1.f));
+	float phi = FastMath::atan2(d.z, d.x) + M_PI;
 	phi /= 2 * M_PI;
 	theta /= M_PI;
 	return glm::vec2(phi, 1.f - theta);
 }
 
 glm::vec3 EnvironmentEmitter::uv2dir(const glm::vec2& uv) const {
+	if (mapping == EnvironmentMapping::OCTAHEDRAL) {
+		glm::vec3 d = Sampling::equalAreaSquareToSphere(uv);
+		return inverseRotateDir(glm::vec3(d.x, d.z, d.y));
+	}
+
 	float theta = (1 - uv.y) * M_PI;
 	float phi = uv.x * 2 * M_PI - M_PI;
-	float y = cos(theta);
-	float xz = sqrtf(1 - y * y);
-	float x = xz * cos(phi);
-	float z = xz * sin(phi);
-	return rotateDir(glm::vec3(x, y, z));
+	float y = FastMath::cos(theta);
+	float xz = sqrtf(fmaxf(0.f, 1 - y * y));
+	float x = xz * FastMath::cos(phi);
+	float z = xz * FastMath::sin(phi);
+	return inverseRotateDir(glm::vec3(x, y, z));
 }
 
 glm::vec2 EnvironmentEmitter::uv2img(const glm::vec2& uv) const {
@@ -66,10 +120,22 @@ glm::vec2 EnvironmentEmitter::img2uv(const glm::vec2& img) const {
 	return glm::vec2(img.x / dims.x, 1.f - img.y / dims.y);
 }
 
+// Converts the pdf of picking a pixel to solid angle at direction dir
+float EnvironmentEmitter::pdfSolidAngle(float pdfImage, const glm::vec3& dir) const {
+	if (mapping == EnvironmentMapping::OCTAHEDRAL) {
+		return pdfImage * dims.x * dims.y / (4 * M_PI);
+	}
+
+	// Rotation around y keeps sinTheta
+	float sinTheta = sqrtf(fmaxf(0.f, 1.f - dir.y * dir.y));
+	if (sinTheta <= 0.f) return 0.f;
+	return pdfImage * dims.x * dims.y / (2 * M_PI * M_PI * sinTheta);
+}
+
 glm::vec3 EnvironmentEmitter::eval(EmitterInteraction& ei) const {
 	glm::vec2 uv = dir2uv(ei.direction);
 	glm::ivec2 img = uv2img(uv);
-	ei.pdf = samplingDistribution.pdf(img);
+	ei.pdf = pdfSolidAngle(samplingDistribution.pdf(img), ei.direction);
 	return intensity * map->eval(uv);
 }
 
@@ -82,7 +148,7 @@ glm::vec3 EnvironmentEmitter::sample(const glm::vec3& s, EmitterInteraction& ei)
 	ei.direction = dir;
 	ei.normal = -dir;
 	ei.shadowRay = Ray(ei.origin, ei.direction);
-	float w = sin(M_PI * img.y / dims.y);
-	ei.pdf = ei.pdf * dims.x * dims.y / (2 * M_PI * M_PI * w);
+	ei.pdf = pdfSolidAngle(ei.pdf, dir);
+	if (ei.pdf <= 0.f) return glm::vec3(0.f);
 	return intensity * map->eval(uv) / ei.pdf;
-}
\ No newline at end of file
+}
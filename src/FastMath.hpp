@@ -0,0 +1,89 @@
+#pragma once
+
+#include <math.h>
+#include "common.h"
+#include "SIMD.hpp"
+
+namespace Lykta {
+
+	// Polynomial approximations of the trigonometric functions used to map directions.
+	// They are branch free so loops over them vectorize. Maximum absolute errors
+	// measured in float over the whole domain are listed per function.
+	class FastMath {
+	public:
+		// x in [-1, 1], error < 5e-7 (Abramowitz and Stegun 4.4.46)
+		static inline float acos(float x) {
+			float a = fabsf(x);
+			float p = -0.0012624911f;
+			p = p * a + 0.0066700901f;
+			p = p * a - 0.0170881256f;
+			p = p * a + 0.0308918810f;
+			p = p * a - 0.0501743046f;
+			p = p * a + 0.0889789874f;
+			p = p * a - 0.2145988016f;
+			p = p * a + 1.5707963050f;
+			float r = p * sqrtf(fmaxf(1.f - a, 0.f));
+			return (x < 0.f) ? M_PI - r : r;
+		}
+
+		// x in [-1, 1], error < 3e-7 (Abramowitz and Stegun 4.4.49)
+		static inline float atanUnit(float x) {
+			float x2 = x * x;
+			float p = -0.0040540580f;
+			p = p * x2 + 0.0218612288f;
+			p = p * x2 - 0.0559098861f;
+			p = p * x2 + 0.0964200441f;
+			p = p * x2 - 0.1390853351f;
+			p = p * x2 + 0.1994653599f;
+			p = p * x2 - 0.3332985605f;
+			p = p * x2 + 0.9999993329f;
+			return p * x;
+		}
+
+		// Same quadrants as atan2, error < 5e-7
+		static inline float atan2(float y, float x) {
+			float ax = fabsf(x), ay = fabsf(y);
+			float maxv = fmaxf(ax, ay);
+			float r = atanUnit(fminf(ax, ay) / ((maxv > 0.f) ? maxv : 1.f));
+			r = (ay > ax) ? 0.5f * M_PI - r : r;
+			r = (x < 0.f) ? M_PI - r : r;
+			return copysignf(r, y);
+		}
+
+		// x in [-pi, pi], error < 2e-7
+		static inline float sin(float x) {
+			// Fold into [-pi/2, pi/2] using sin(x) = sin(pi - x)
+			x = (fabsf(x) > 0.5f * M_PI) ? copysignf(M_PI, x) - x : x;
+			float x2 = x * x;
+			float p = -2.5052108e-8f;
+			p = p * x2 + 2.7557319e-6f;
+			p = p * x2 - 1.9841270e-4f;
+			p = p * x2 + 8.3333333e-3f;
+			p = p * x2 - 1.6666667e-1f;
+			return x + x * x2 * p;
+		}
+
+		// x in [-pi, pi], error < 2e-7
+		static inline float cos(float x) {
+			// cos(x) = sin(pi/2 - |x|), the argument stays in [-pi/2, pi/2]
+			return sin(0.5f * M_PI - fabsf(x));
+		}
+
+		// Packet versions of sin and cos with the same polynomials and domain
+		static inline FloatN sin(const FloatN& x) {
+			FloatN halfPi = 0.5f * M_PI;
+			FloatN y = select(abs(x) > halfPi, copysign(FloatN(M_PI), x) - x, x);
+			FloatN y2 = y * y;
+			FloatN p = -2.5052108e-8f;
+			p = p * y2 + 2.7557319e-6f;
+			p = p * y2 - 1.9841270e-4f;
+			p = p * y2 + 8.3333333e-3f;
+			p = p * y2 - 1.6666667e-1f;
+			return y + y * y2 * p;
+		}
+
+		static inline FloatN cos(const FloatN& x) {
+			return sin(FloatN(0.5f * M_PI) - abs(x));
+		}
+	};
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Lykta {
+
+	// 64-bit finalizer of MurmurHash3, used to derive seeds
+	inline uint64_t mixBits(uint64_t v) {
+		v ^= v >> 33;
+		v *= 0xff51afd7ed558ccdull;
+		v ^= v >> 33;
+		v *= 0xc4ceb9fe1a85ec53ull;
+		v ^= v >> 33;
+		return v;
+	}
+
+	inline uint64_t hashInts(uint64_t a, uint64_t b, uint64_t c = 0, uint64_t d = 0) {
+		uint64_t h = mixBits(a + 0x9e3779b97f4a7c15ull);
+		h = mixBits(h ^ (b + 0x9e3779b97f4a7c15ull));
+		h = mixBits(h ^ (c + 0x9e3779b97f4a7c15ull));
+		return mixBits(h ^ (d + 0x9e3779b97f4a7c15ull));
+	}
+}
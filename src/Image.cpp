@@ -4,6 +4,11 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb/stb_image_write.h"
 #include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "ImageWriter.hpp"
+#include "Trace.hpp"
 
 using namespace Lykta;
 
@@ -28,8 +33,50 @@ Image<glm::vec4>::Image(int w, int h) {
 	height = h;
 }
 
+// Reads a portable float map with one or three channels, e.g. a render saved as .pfm.
+// stb_image has no float formats besides .hdr.
+static bool loadPFM(const std::string& path, int& width, int& height, std::vector<glm::vec3>& data) {
+	std::ifstream in(path.c_str(), std::ios::binary);
+	std::string magic;
+	float scale = 0.f;
+	in >> magic >> width >> height >> scale;
+	in.get();
+	if (!in || (magic != "PF" && magic != "Pf") || width <= 0 || height <= 0) return false;
+
+	int channels = (magic == "PF") ? 3 : 1;
+	std::vector<float> row = std::vector<float>((size_t)width * channels);
+	data = std::vector<glm::vec3>((size_t)width * height);
+	for (int j = height - 1; j >= 0; j--) {
+		in.read(reinterpret_cast<char*>(row.data()), row.size() * sizeof(float));
+		// A positive scale marks big endian data
+		if (scale > 0.f) {
+			for (float& value : row) {
+				uint32_t bits;
+				memcpy(&bits, &value, sizeof(float));
+				bits = (bits >> 24) | ((bits >> 8) & 0xff00u) | ((bits << 8) & 0xff0000u) | (bits << 24);
+				memcpy(&value, &bits, sizeof(float));
+			}
+		}
+		for (int i = 0; i < width; i++) {
+			const float* p = &row[(size_t)i * channels];
+			data[(size_t)j * width + i] = (channels == 3) ? glm::vec3(p[0], p[1], p[2]) : glm::vec3(p[0]);
+		}
+	}
+	return (bool)in;
+}
+
 template <>
 Image<glm::vec3>::Image(const std::string& path) {
+	TraceScope trace("Image::load");
+	if (ImageWriter::extension(path) == "pfm") {
+		if (!loadPFM(path, width, height, data)) {
+			std::cerr << "Failed to read " << path << std::endl;
+			width = height = 0;
+			data.clear();
+		}
+		return;
+	}
+
 	int channels = 0;
 	float* out = stbi_loadf(path.c_str(), &width, &height, &channels, 0);
 	data = std::vector<glm::vec3>(width * height);
@@ -53,6 +100,7 @@ Image<glm::vec3>::Image(const std::string& path) {
 
 template <>
 Image<glm::vec4>::Image(const std::string& path) {
+	TraceScope trace("Image::load");
 	int channels = 0;
 	float* out = stbi_loadf(path.c_str(), &width, &height, &channels, 0);
 	data = std::vector<glm::vec4>(width * height);
@@ -78,6 +126,7 @@ Image<glm::vec4>::Image(const std::string& path) {
 
 template <>
 Image<float>::Image(const std::string& path) {
+	TraceScope trace("Image::load");
 	int channels = 0;
 	float* out = stbi_loadf(path.c_str(), &width, &height, &channels, 0);
 	data = std::vector<float>(width * height);
@@ -93,46 +142,132 @@ Image<float>::Image(const std::string& path) {
 	delete[] out;
 }
 
+const unsigned char* Lykta::srgbTable() {
+	static const std::vector<unsigned char> table = []() {
+		std::vector<unsigned char> values = std::vector<unsigned char>(65536);
+		#pragma omp parallel for
+		for (int i = 0; i < 65536; i++) {
+			float linear = i / 65535.f;
+			float v = (linear <= 0.0031308f) ? 12.92f * linear : (1 + 0.055f) * powf(linear, 1.f / 2.4f) - 0.055f;
+			values[i] = (unsigned char)std::max(std::min(255 * v + 0.5f, 255.f), 0.f);
+		}
+		return values;
+	}();
+	return table.data();
+}
+
+// Writes float formats straight from the pixel data, returns false for 8-bit formats
+static bool saveFloat(const std::string& path, int width, int height, int channels, const float* data) {
+	std::string ext = ImageWriter::extension(path);
+
+	if (ext == "hdr") {
+		if (!stbi_write_hdr(path.c_str(), width, height, channels, data)) {
+			std::cerr << "Failed to write " << path << std::endl;
+		}
+		return true;
+	}
+
+	if (!ImageWriter::supportsFormat(path)) return false;
+
+	std::vector<std::string> names;
+	if (channels == 1) names = { "Y" };
+	else if (channels == 3) names = { "R", "G", "B" };
+	else names = { "R", "G", "B", "A" };
+
+	std::unique_ptr<ImageWriter> writer = ImageWriter::create(path, width, height, names);
+	if (writer) {
+		// Pixel data is already interleaved floats, write it in bands
+		const int band = 64;
+		for (int y = 0; y < height; y += band) {
+			writer->writeRows(y, std::min(band, height - y), data + (size_t)y * width * channels);
+		}
+		writer->close();
+	}
+	return true;
+}
+
 template <>
 void Image<glm::vec3>::save(const std::string& path) const {
+	TraceScope trace("Image::save");
+	if (saveFloat(path, width, height, 3, &data[0].x)) return;
+
+	const unsigned char* table = srgbTable();
 	std::vector<unsigned char> image = std::vector<unsigned char>(width * height * 3);
+	#pragma omp parallel for
 	for (int i = 0; i < width * height; i++) {
-		unsigned char r = linear_to_srgb(data[i].x);
-		unsigned char g = linear_to_srgb(data[i].y);
-		unsigned char b = linear_to_srgb(data[i].z);
-
-		image[i * 3 + 0] = r;
-		image[i * 3 + 1] = g;
-		image[i * 3 + 2] = b;
+		image[i * 3 + 0] = linear_to_srgb(data[i].x, table);
+		image[i * 3 + 1] = linear_to_srgb(data[i].y, table);
+		image[i * 3 + 2] = linear_to_srgb(data[i].z, table);
 	}
 
+	TraceScope encode("PNG encode");
 	stbi_write_png(path.c_str(), width, height, 3, image.data(), 0);
 }
 
 template <>
 void Image<glm::vec4>::save(const std::string& path) const {
+	TraceScope trace("Image::save");
+	if (saveFloat(path, width, height, 4, &data[0].x)) return;
+
+	const unsigned char* table = srgbTable();
 	std::vector<unsigned char> image = std::vector<unsigned char>(width * height * 4);
+	#pragma omp parallel for
 	for (int i = 0; i < width * height; i++) {
-		unsigned char r = linear_to_srgb(data[i].x);
-		unsigned char g = linear_to_srgb(data[i].y);
-		unsigned char b = linear_to_srgb(data[i].z);
-		unsigned char a = linear_to_srgb(data[i].w);
-
-		image[i * 4 + 0] = r;
-		image[i * 4 + 1] = g;
-		image[i * 4 + 2] = b;
-		image[i * 4 + 3] = a;
+		image[i * 4 + 0] = linear_to_srgb(data[i].x, table);
+		image[i * 4 + 1] = linear_to_srgb(data[i].y, table);
+		image[i * 4 + 2] = linear_to_srgb(data[i].z, table);
+		image[i * 4 + 3] = linear_to_srgb(data[i].w, table);
 	}
 
+	TraceScope encode("PNG encode");
 	stbi_write_png(path.c_str(), width, height, 4, image.data(), 0);
 }
 
 template <>
 void Image<float>::save(const std::string& path) const {
+	TraceScope trace("Image::save");
+	if (saveFloat(path, width, height, 1, data.data())) return;
+
+	const unsigned char* table = srgbTable();
 	std::vector<unsigned char> image = std::vector<unsigned char>(width * height);
+	#pragma omp parallel for
 	for (int i = 0; i < width * height; i++) {
-		image[i] = linear_to_srgb(data[i]);
+		image[i] = linear_to_srgb(data[i], table);
 	}
 
+	TraceScope encode("PNG encode");
 	stbi_write_png(path.c_str(), width, height, 1, image.data(), 0);
-}
\ No newline at end of file
+}
+
+namespace {
+	const uint64_t FNV_OFFSET = 14695981039346656037ull;
+	const uint64_t FNV_PRIME = 1099511628211ull;
+
+	// FNV-1a over 32-bit words, pixel data is always a multiple of 4 bytes
+	inline uint64_t fnv1a(uint64_t h, const uint32_t* words, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			h ^= words[i];
+			h *= FNV_PRIME;
+		}
+		return h;
+	}
+}
+
+template <typename T>
+uint64_t Image<T>::hash() const {
+	std::vector<uint64_t> rowHashes = std::vector<uint64_t>(height);
+	size_t rowWords = width * sizeof(T) / sizeof(uint32_t);
+
+	#pragma omp parallel for
+	for (int j = 0; j < height; j++) {
+		rowHashes[j] = fnv1a(FNV_OFFSET, (const uint32_t*)&data[(size_t)j * width], rowWords);
+	}
+
+	uint32_t dims[2] = { (uint32_t)width, (uint32_t)height };
+	uint64_t h = fnv1a(FNV_OFFSET, dims, 2);
+	return fnv1a(h, (const uint32_t*)rowHashes.data(), rowHashes.size() * 2);
+}
+
+template uint64_t Image<float>::hash() const;
+template uint64_t Image<glm::vec3>::hash() const;
+template uint64_t Image<glm::vec4>::hash() const;
@@ -1,4 +1,6 @@
 #pragma once
+#include <memory>
+#include <stdint.h>
 #include <vector>
 #include <string>
 #include <algorithm>
@@ -9,6 +11,9 @@
 
 namespace Lykta {
 
+	// 8-bit sRGB values of linear intensities in [0, 1] at 16-bit precision
+	const unsigned char* srgbTable();
+
 	template <typename T>
 	class Image {
 
@@ -16,14 +21,14 @@ namespace Lykta {
 		std::vector<T> data;
 		int width, height;
 
-		inline unsigned char linear_to_srgb(float linear) const {
-			float v = (linear <= 0.0031308f) ? 12.92f * linear : (1 + 0.055f) * pow(linear, 1.f / 2.4f) - 0.055f;
-			float u = 255 * v;
-			unsigned char result = std::max(std::min(u, 255.f), 0.f);
-			return result;
+		inline unsigned char linear_to_srgb(float linear, const unsigned char* table) const {
+			// fmaxf maps NaN to zero
+			float u = fminf(fmaxf(linear, 0.f), 1.f) * 65535.f + 0.5f;
+			return table[(int)u];
 		}
 
 	public:
+		// Loaded with stb_image, RGB images can also be read from .pfm
 		Image(const std::string& path);
 		Image(int w, int h);
 		Image() {}
@@ -32,6 +37,10 @@ namespace Lykta {
 			return data[i];
 		}
 
+		const T& operator[](int i) const {
+			return data[i];
+		}
+
         T read(int i) {
             return data[i];
         }
@@ -40,6 +49,8 @@ namespace Lykta {
 			return data[index.y * width + index.x];
 		}
 
+		// Format is chosen by extension: .exr, .pfm and .hdr keep full float
+		// precision, anything else is written as 8-bit sRGB PNG
 		void save(const std::string& path) const;
 
         glm::ivec2 getDims() const {
@@ -50,6 +61,13 @@ namespace Lykta {
 			return data.data();
 		}
 
+		const T* getData() const {
+			return data.data();
+		}
+
+		// 64-bit FNV-1a hash of the dimensions and pixel values, rows are hashed in parallel
+		uint64_t hash() const;
+
 	};
 
 	template <typename T>
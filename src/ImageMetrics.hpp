@@ -0,0 +1,56 @@
+#pragma once
+
+#include <math.h>
+#include <vector>
+#include "Image.hpp"
+
+namespace Lykta {
+
+	// Error metrics of a rendered image against a reference of the same size
+	class ImageMetrics {
+	public:
+		// Root mean squared error over all pixels and channels
+		static double rmse(const Image<glm::vec3>& image, const Image<glm::vec3>& reference) {
+			glm::ivec2 dims = image.getDims();
+			int n = dims.x * dims.y;
+			if (n == 0 || reference.getDims() != dims) return -1.0;
+
+			// Row sums keep the result independent of the thread count
+			std::vector<double> rowSums = std::vector<double>(dims.y, 0.0);
+			#pragma omp parallel for
+			for (int j = 0; j < dims.y; j++) {
+				for (int i = j * dims.x; i < (j + 1) * dims.x; i++) {
+					glm::vec3 d = image[i] - reference[i];
+					rowSums[j] += (double)d.x * d.x + (double)d.y * d.y + (double)d.z * d.z;
+				}
+			}
+
+			double sum = 0.0;
+			for (double rowSum : rowSums) sum += rowSum;
+			return sqrt(sum / (3.0 * n));
+		}
+
+		// Relative mean squared error (x - r)^2 / (r^2 + epsilon) over all pixels and
+		// channels. Epsilon keeps dark pixels from dominating the mean.
+		static double relMSE(const Image<glm::vec3>& image, const Image<glm::vec3>& reference, float epsilon = 0.01f) {
+			glm::ivec2 dims = image.getDims();
+			int n = dims.x * dims.y;
+			if (n == 0 || reference.getDims() != dims) return -1.0;
+
+			std::vector<double> rowSums = std::vector<double>(dims.y, 0.0);
+			#pragma omp parallel for
+			for (int j = 0; j < dims.y; j++) {
+				for (int i = j * dims.x; i < (j + 1) * dims.x; i++) {
+					glm::vec3 d = image[i] - reference[i];
+					glm::vec3 r = reference[i];
+					rowSums[j] += d.x * d.x / (r.x * r.x + epsilon) + d.y * d.y / (r.y * r.y + epsilon)
+						+ d.z * d.z / (r.z * r.z + epsilon);
+				}
+			}
+
+			double sum = 0.0;
+			for (double rowSum : rowSums) sum += rowSum;
+			return sum / (3.0 * n);
+		}
+	};
+}
@@ -0,0 +1,179 @@
+#include "ImageWriter.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+
+using namespace Lykta;
+
+// Both formats are written little endian, which matches the platforms Lykta runs on
+template <typename T>
+static void writeValue(std::ofstream& out, T value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void writeString(std::ofstream& out, const std::string& str) {
+	out.write(str.c_str(), str.size() + 1);
+}
+
+std::string ImageWriter::extension(const std::string& path) {
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos) return "";
+	std::string ext = path.substr(dot + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext;
+}
+
+bool ImageWriter::supportsFormat(const std::string& path) {
+	std::string ext = extension(path);
+	return ext == "exr" || ext == "pfm";
+}
+
+bool ImageWriter::supportsChannels(const std::string& path, int numChannels) {
+	std::string ext = extension(path);
+	if (ext == "pfm") return numChannels == 1 || numChannels == 3;
+	return ext == "exr";
+}
+
+std::unique_ptr<ImageWriter> ImageWriter::create(const std::string& path, int width, int height, const std::vector<std::string>& channels) {
+	std::string ext = extension(path);
+	std::unique_ptr<ImageWriter> writer;
+
+	if (ext == "exr") {
+		writer = std::unique_ptr<ImageWriter>(new EXRWriter(path, width, height, channels));
+	}
+	else if (ext == "pfm") {
+		if (channels.size() != 1 && channels.size() != 3) {
+			std::cerr << "PFM supports only one or three channels, cannot write " << path << std::endl;
+			return nullptr;
+		}
+		writer = std::unique_ptr<ImageWriter>(new PFMWriter(path, width, height, channels));
+	}
+	else {
+		return nullptr;
+	}
+
+	if (!writer->isOpen()) {
+		std::cerr << "Failed to open " << path << " for writing!" << std::endl;
+		return nullptr;
+	}
+
+	return writer;
+}
+
+PFMWriter::PFMWriter(const std::string& path, int w, int h, const std::vector<std::string>& channelNames)
+	: ImageWriter(w, h, channelNames) {
+	out.open(path, std::ios::binary);
+	// Negative scale marks little endian data
+	out << ((channels.size() == 3) ? "PF" : "Pf") << "\n" << width << " " << height << "\n-1.0\n";
+	dataStart = out.tellp();
+}
+
+void PFMWriter::writeRows(int y, int count, const float* rows) {
+	size_t rowFloats = (size_t)width * channels.size();
+
+	// Rows are stored from bottom to top
+	for (int i = 0; i < count; i++) {
+		int fileRow = height - 1 - (y + i);
+		out.seekp(dataStart + std::streamoff(fileRow * rowFloats * sizeof(float)));
+		out.write(reinterpret_cast<const char*>(rows + i * rowFloats), rowFloats * sizeof(float));
+	}
+}
+
+EXRWriter::EXRWriter(const std::string& path, int w, int h, const std::vector<std::string>& channelNames)
+	: ImageWriter(w, h, channelNames) {
+	out.open(path, std::ios::binary);
+
+	channelOrder = std::vector<int>(channels.size());
+	std::iota(channelOrder.begin(), channelOrder.end(), 0);
+	std::sort(channelOrder.begin(), channelOrder.end(), [&](int a, int b) { return channels[a] < channels[b]; });
+
+	// Magic number and version 2 without any flags (single part scanline file)
+	writeValue<int32_t>(out, 20000630);
+	writeValue<int32_t>(out, 2);
+
+	// Channel list, each entry is 18 bytes plus the name
+	int32_t channelListSize = 1;
+	for (const std::string& name : channels) channelListSize += (int32_t)name.size() + 1 + 16;
+	writeString(out, "channels");
+	writeString(out, "chlist");
+	writeValue<int32_t>(out, channelListSize);
+	for (int c : channelOrder) {
+		writeString(out, channels[c]);
+		writeValue<int32_t>(out, 2); // FLOAT
+		writeValue<int32_t>(out, 0); // pLinear and reserved bytes
+		writeValue<int32_t>(out, 1); // x sampling
+		writeValue<int32_t>(out, 1); // y sampling
+	}
+	writeValue<uint8_t>(out, 0);
+
+	writeString(out, "compression");
+	writeString(out, "compression");
+	writeValue<int32_t>(out, 1);
+	writeValue<uint8_t>(out, 0); // NO_COMPRESSION
+
+	for (const char* window : { "dataWindow", "displayWindow" }) {
+		writeString(out, window);
+		writeString(out, "box2i");
+		writeValue<int32_t>(out, 16);
+		writeValue<int32_t>(out, 0);
+		writeValue<int32_t>(out, 0);
+		writeValue<int32_t>(out, width - 1);
+		writeValue<int32_t>(out, height - 1);
+	}
+
+	writeString(out, "lineOrder");
+	writeString(out, "lineOrder");
+	writeValue<int32_t>(out, 1);
+	writeValue<uint8_t>(out, 0); // INCREASING_Y
+
+	writeString(out, "pixelAspectRatio");
+	writeString(out, "float");
+	writeValue<int32_t>(out, 4);
+	writeValue<float>(out, 1.f);
+
+	writeString(out, "screenWindowCenter");
+	writeString(out, "v2f");
+	writeValue<int32_t>(out, 8);
+	writeValue<float>(out, 0.f);
+	writeValue<float>(out, 0.f);
+
+	writeString(out, "screenWindowWidth");
+	writeString(out, "float");
+	writeValue<int32_t>(out, 4);
+	writeValue<float>(out, 1.f);
+
+	writeValue<uint8_t>(out, 0); // end of header
+
+	// Uncompressed blocks have a fixed size, so the offset table is known up front
+	uint64_t blockSize = 8 + (uint64_t)width * channels.size() * sizeof(float);
+	uint64_t offset = (uint64_t)out.tellp() + (uint64_t)height * sizeof(uint64_t);
+	for (int y = 0; y < height; y++) {
+		writeValue<uint64_t>(out, offset + y * blockSize);
+	}
+	dataStart = out.tellp();
+}
+
+void EXRWriter::writeRows(int y, int count, const float* rows) {
+	int numChannels = (int)channels.size();
+	size_t rowFloats = (size_t)width * numChannels;
+	uint64_t blockSize = 8 + rowFloats * sizeof(float);
+	std::vector<float> block = std::vector<float>(rowFloats);
+
+	for (int i = 0; i < count; i++) {
+		// Scanline data is planar, one channel after another in alphabetical order
+		const float* row = rows + i * rowFloats;
+		for (int c = 0; c < numChannels; c++) {
+			float* plane = block.data() + c * width;
+			int source = channelOrder[c];
+			for (int x = 0; x < width; x++) {
+				plane[x] = row[x * numChannels + source];
+			}
+		}
+
+		out.seekp(dataStart + std::streamoff((y + i) * blockSize));
+		writeValue<int32_t>(out, y + i);
+		writeValue<int32_t>(out, (int32_t)(rowFloats * sizeof(float)));
+		out.write(reinterpret_cast<const char*>(block.data()), rowFloats * sizeof(float));
+	}
+}
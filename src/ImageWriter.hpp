@@ -0,0 +1,73 @@
+#pragma once
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Lykta {
+
+	// Writes float images scanline by scanline. Every scanline has a fixed
+	// location in the file, so rows can be written in any order as soon as
+	// they are finished without keeping a converted copy of the image.
+	class ImageWriter {
+	protected:
+		std::ofstream out;
+		int width, height;
+		std::vector<std::string> channels;
+
+	public:
+		ImageWriter(int w, int h, const std::vector<std::string>& channelNames) : width(w), height(h), channels(channelNames) {}
+		virtual ~ImageWriter() {}
+
+		bool isOpen() const {
+			return out.is_open() && out.good();
+		}
+
+		int numChannels() const {
+			return (int)channels.size();
+		}
+
+		// Writes count rows starting at y. Pixels are interleaved in the
+		// channel order given at creation, i.e. width * numChannels() floats per row.
+		virtual void writeRows(int y, int count, const float* rows) = 0;
+
+		void close() {
+			out.close();
+		}
+
+		// Lower case file extension without the dot
+		static std::string extension(const std::string& path);
+
+		// Returns true if the extension of path has a streaming writer
+		static bool supportsFormat(const std::string& path);
+
+		// Returns true if the streaming writer of path holds numChannels channels in one file
+		static bool supportsChannels(const std::string& path, int numChannels);
+
+		// Creates a writer based on the extension of path (.exr or .pfm)
+		// Returns nullptr if the format or the channel layout is not supported
+		static std::unique_ptr<ImageWriter> create(const std::string& path, int width, int height, const std::vector<std::string>& channels);
+	};
+
+	// Portable float map, holds one (Pf) or three (PF) channels
+	class PFMWriter : public ImageWriter {
+	private:
+		std::streampos dataStart;
+
+	public:
+		PFMWriter(const std::string& path, int w, int h, const std::vector<std::string>& channelNames);
+		virtual void writeRows(int y, int count, const float* rows);
+	};
+
+	// Uncompressed single-part scanline OpenEXR with 32-bit float channels
+	class EXRWriter : public ImageWriter {
+	private:
+		std::streampos dataStart;
+		// Channels are stored in alphabetical order, this maps them to input order
+		std::vector<int> channelOrder;
+
+	public:
+		EXRWriter(const std::string& path, int w, int h, const std::vector<std::string>& channelNames);
+		virtual void writeRows(int y, int count, const float* rows);
+	};
+}
@@ -1,29 +1,69 @@
 #pragma once
 
 #include <glm/vec3.hpp>
+#include <atomic>
 #include <memory>
+#include <string>
+#include <vector>
 #include "common.h"
-#include "RandomPool.hpp"
+#include "Sampler.hpp"
 #include "Scene.hpp"
+#include "AOV.hpp"
+#include "Denoiser.hpp"
+#include "Image.hpp"
 
 namespace Lykta {
 	class Scene;
     class Integrator {
+	protected:
+		std::shared_ptr<Denoiser> denoiser;
 
 	public:
 		enum Type {
 			PT = 0,
 			BSDF = 1,
-			AO = 2
+			AO = 2,
+			WAVEFRONT = 3
 		};
 
 		virtual ~Integrator() {}
 		
 		virtual void preprocess(const std::shared_ptr<Scene> scene) {}
 
-		virtual glm::vec3 evaluate(const Ray& ray, const std::shared_ptr<Scene> scene) = 0;
+		// Returns the radiance along ray and fills in the output variables of the path.
+		// The sampler is positioned after the camera dimensions of the pixel sample.
+		virtual glm::vec3 evaluate(const Ray& ray, const std::shared_ptr<Scene> scene, Sampler& sampler, AOVSample& aov) = 0;
 
-		virtual void postprocess(const std::shared_ptr<Scene> scene) {}
+		// Runs once on the accumulated image after the last frame.
+		// The default denoises it when a denoiser and its guide AOVs are present.
+		virtual void postprocess(const std::shared_ptr<Scene> scene, Image<glm::vec3>& image,
+			const Image<glm::vec3>* albedo, const Image<glm::vec3>* normal) {
+			if (denoiser && albedo && normal) denoiser->denoise(image, *albedo, *normal);
+		}
+
+		void setDenoiser(std::shared_ptr<Denoiser> d) {
+			denoiser = d;
+		}
+
+		// Wavefront integrators trace the paths of all pixels together through
+		// evaluateFrame instead of calling evaluate once per pixel
+		virtual bool isWavefront() const {
+			return false;
+		}
+
+		// Radiance and output variables of one camera ray per pixel, the sampler is
+		// positioned per pixel with startPixelSample(pixel, sampleIndex, 4). Returns
+		// false if cancel was set before the frame was finished.
+		virtual bool evaluateFrame(const std::vector<Ray>& /*rays*/, const std::shared_ptr<Scene> /*scene*/, const Sampler& /*sampler*/,
+			uint32_t /*sampleIndex*/, int /*width*/, std::vector<glm::vec3>& /*radiance*/, std::vector<AOVSample>& /*aovs*/,
+			const std::atomic<bool>& /*cancel*/) {
+			return true;
+		}
+
+		// Human readable counters gathered since the integrator was created, empty if there are none
+		virtual std::string getStatistics() const {
+			return "";
+		}
 
 	};
 
@@ -33,7 +73,7 @@ namespace Lykta {
     public:
         AOIntegrator() {}
         ~AOIntegrator() {}
-        virtual glm::vec3 evaluate(const Ray& ray, const std::shared_ptr<Scene> scene);
+        virtual glm::vec3 evaluate(const Ray& ray, const std::shared_ptr<Scene> scene, Sampler& sampler, AOVSample& aov);
     };
 
 	class BSDFIntegrator : public Integrator {
@@ -42,7 +82,61 @@ namespace Lykta {
 	public:
 		BSDFIntegrator() {}
 		~BSDFIntegrator() {}
-		virtual glm::vec3 evaluate(const Ray& ray, const std::shared_ptr<Scene> scene);
+		virtual glm::vec3 evaluate(const Ray& ray, const std::shared_ptr<Scene> scene, Sampler& sampler, AOVSample& aov);
+	};
+
+	// Same paths as BSDFIntegrator, traced one bounce at a time for all pixels.
+	// Hits of every bounce are optionally radix sorted by material before shading,
+	// so that packets share one material and its textures stay in cache.
+	class WavefrontIntegrator : public BSDFIntegrator {
+	private:
+		struct PathState {
+			Ray ray;
+			glm::vec3 throughput;
+			int pixel;
+			unsigned bounces;
+		};
+
+		struct ShadingStats {
+			// One batch per bounce
+			uint64_t batches = 0;
+			uint64_t hits = 0;
+			// Sequences of consecutive hits with the same material in shading order
+			uint64_t runs = 0;
+			uint64_t packets = 0;
+		};
+
+		bool sortByMaterial;
+		// Material and sort key of every geometry, keys are dense material indices
+		std::vector<MaterialPtr> geometryMaterials;
+		std::vector<uint16_t> materialKeys;
+		int numMaterials = 0;
+		std::vector<PathState> paths, nextPaths;
+		std::vector<Hit> hits;
+		std::vector<char> alive;
+		std::vector<uint16_t> keys;
+		std::vector<uint32_t> order, scratch;
+		std::vector<glm::ivec2> packets;
+		ShadingStats stats;
+
+		void shadePacket(const std::shared_ptr<Scene>& scene, Sampler& sampler, uint32_t sampleIndex, int width,
+			const uint32_t* indices, int count, std::vector<glm::vec3>& radiance, std::vector<AOVSample>& aovs);
+
+	public:
+		WavefrontIntegrator(bool sort = true) : sortByMaterial(sort) {}
+		~WavefrontIntegrator() {}
+
+		virtual void preprocess(const std::shared_ptr<Scene> scene);
+
+		virtual bool isWavefront() const {
+			return true;
+		}
+
+		virtual bool evaluateFrame(const std::vector<Ray>& rays, const std::shared_ptr<Scene> scene, const Sampler& sampler,
+			uint32_t sampleIndex, int width, std::vector<glm::vec3>& radiance, std::vector<AOVSample>& aovs,
+			const std::atomic<bool>& cancel);
+
+		virtual std::string getStatistics() const;
 	};
 
 	class Unidirectional : public Integrator {
@@ -51,6 +145,6 @@ namespace Lykta {
 	public:
 		Unidirectional() {}
 		~Unidirectional() {}
-		virtual glm::vec3 evaluate(const Ray& ray, const std::shared_ptr<Scene> scene);
+		virtual glm::vec3 evaluate(const Ray& ray, const std::shared_ptr<Scene> scene, Sampler& sampler, AOVSample& aov);
 	};
 }
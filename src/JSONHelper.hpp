@@ -9,6 +9,7 @@
 #include <rapidjson/rapidjson.h>
 #include <rapidjson/document.h>
 #include <fstream>
+#include <sstream>
 #include <glm/gtc/matrix_access.hpp>
 #include "Camera.hpp"
 #include "RealisticCamera.hpp"
@@ -16,6 +17,9 @@
 #include "Mesh.hpp"
 #include "Emitter.hpp"
 #include "Texture.hpp"
+#include "AOV.hpp"
+#include "Sampler.hpp"
+#include "AssetCache.hpp"
 
 namespace Lykta {
 
@@ -90,53 +94,96 @@ namespace Lykta {
             return true;
         }
 
-        static TexturePtr<float> readFloatTexture(const std::string& name, const rapidjson::Value& val,
-                                             filesystem::path& scenepath) {
-            TexturePtr<float> ptr = nullptr;
-            if (val.HasMember(name.c_str())) {
-                const rapidjson::Value& file = val[name.c_str()];
-                if (file.IsString()) {
-                    std::string filename = std::string(file.GetString());
-                    if (getRealPath(filename, scenepath)) return TexturePtr<float>(new Texture<float>(filename));
-                    else return nullptr;
-                } else {
-                    std::cout << "Texture: " << name.c_str() << " is not a string!" << std::endl;
-                }
-            }
+        static WrapMode readWrapMode(const rapidjson::Value& val) {
+            if (!val.HasMember("wrap") || !val["wrap"].IsString()) return WrapMode::REPEAT;
+            const std::string wrap = val["wrap"].GetString();
+            if (wrap == "clamp") return WrapMode::CLAMP;
+            else if (wrap == "mirror") return WrapMode::MIRROR;
+            else if (wrap != "repeat") std::cout << "Unknown wrap mode: " << wrap << " -- using repeat." << std::endl;
+            return WrapMode::REPEAT;
+        }
 
-            return ptr;
+        static FilterMode readFilterMode(const rapidjson::Value& val) {
+            if (!val.HasMember("filter") || !val["filter"].IsString()) return FilterMode::NEAREST;
+            const std::string filter = val["filter"].GetString();
+            if (filter == "bilinear") return FilterMode::BILINEAR;
+            else if (filter == "bicubic") return FilterMode::BICUBIC;
+            else if (filter != "nearest") std::cout << "Unknown filter mode: " << filter << " -- using nearest." << std::endl;
+            return FilterMode::NEAREST;
         }
 
-        static TexturePtr<glm::vec3> readVec3Texture(const std::string& name, const rapidjson::Value& val, filesystem::path& scenepath) {
-            TexturePtr<glm::vec3> ptr = nullptr;
-            if (val.HasMember(name.c_str())) {
-                const rapidjson::Value& file = val[name.c_str()];
-                if (file.IsString()) {
-                    std::string filename = std::string(file.GetString());
-                    if (getRealPath(filename, scenepath)) return TexturePtr<glm::vec3>(new Texture<glm::vec3>(filename));
-                    else return nullptr;
-                } else {
-                    std::cout << "Texture: " << name.c_str() << " is not a string!" << std::endl;
+        // A texture is either a file path string or an object such as
+        // { "file": "albedo.png", "wrap": "repeat" | "clamp" | "mirror", "filter": "nearest" | "bilinear" | "bicubic" }
+        static bool readTextureFile(const std::string& name, const rapidjson::Value& val, filesystem::path& scenepath,
+                                    std::string& filename, WrapMode& wrap, FilterMode& filter) {
+            if (!val.HasMember(name.c_str())) return false;
+
+            const rapidjson::Value& tex = val[name.c_str()];
+            const rapidjson::Value* file = &tex;
+            wrap = WrapMode::REPEAT;
+            filter = FilterMode::NEAREST;
+
+            if (tex.IsObject()) {
+                if (!tex.HasMember("file")) {
+                    std::cout << "Texture: " << name.c_str() << " has no file!" << std::endl;
+                    return false;
                 }
+                file = &tex["file"];
+                wrap = readWrapMode(tex);
+                filter = readFilterMode(tex);
+            }
+
+            if (!file->IsString()) {
+                std::cout << "Texture: " << name.c_str() << " is not a string!" << std::endl;
+                return false;
             }
 
-            return ptr;
+            filename = std::string(file->GetString());
+            return getRealPath(filename, scenepath);
         }
 
-        static TexturePtr<glm::vec4> readVec4Texture(const std::string& name, const rapidjson::Value& val, filesystem::path& scenepath) {
-            TexturePtr<glm::vec4> ptr = nullptr;
-            if (val.HasMember(name.c_str())) {
-                const rapidjson::Value& file = val[name.c_str()];
-                if (file.IsString()) {
-                    std::string filename = std::string(file.GetString());
-                    if (getRealPath(filename, scenepath)) return TexturePtr<glm::vec4>(new Texture<glm::vec4>(filename));
-                    else return nullptr;
-                } else {
-                    std::cout << "Texture: " << name.c_str() << " is not a string!" << std::endl;
-                }
-            }
+        // Textures share the images of the asset cache when there is one
+        template <typename T>
+        static TexturePtr<T> createTexture(const std::string& filename, WrapMode wrap, FilterMode filter, AssetCache* assets) {
+            if (assets) return TexturePtr<T>(new Texture<T>(assets->getImage<T>(filename), wrap, filter));
+            return TexturePtr<T>(new Texture<T>(filename, wrap, filter));
+        }
 
-            return ptr;
+        static TexturePtr<float> readFloatTexture(const std::string& name, const rapidjson::Value& val,
+                                             filesystem::path& scenepath, AssetCache* assets = nullptr) {
+            std::string filename;
+            WrapMode wrap;
+            FilterMode filter;
+            if (readTextureFile(name, val, scenepath, filename, wrap, filter)) return createTexture<float>(filename, wrap, filter, assets);
+            return nullptr;
+        }
+
+        static TexturePtr<glm::vec3> readVec3Texture(const std::string& name, const rapidjson::Value& val, filesystem::path& scenepath,
+                                                     AssetCache* assets = nullptr) {
+            std::string filename;
+            WrapMode wrap;
+            FilterMode filter;
+            if (readTextureFile(name, val, scenepath, filename, wrap, filter)) return createTexture<glm::vec3>(filename, wrap, filter, assets);
+            return nullptr;
+        }
+
+        static TexturePtr<glm::vec4> readVec4Texture(const std::string& name, const rapidjson::Value& val, filesystem::path& scenepath,
+                                                     AssetCache* assets = nullptr) {
+            std::string filename;
+            WrapMode wrap;
+            FilterMode filter;
+            if (readTextureFile(name, val, scenepath, filename, wrap, filter)) return createTexture<glm::vec4>(filename, wrap, filter, assets);
+            return nullptr;
+        }
+
+        // Light groups are referenced by name, returns the index of the group or -1
+        static int readLightGroup(const rapidjson::Value& val, std::vector<std::string>& lightGroups) {
+            if (!val.HasMember("lightGroup") || !val["lightGroup"].IsString()) return -1;
+            const std::string name = val["lightGroup"].GetString();
+            auto it = std::find(lightGroups.begin(), lightGroups.end(), name);
+            if (it != lightGroups.end()) return (int)std::distance(lightGroups.begin(), it);
+            lightGroups.push_back(name);
+            return (int)lightGroups.size() - 1;
         }
 
 	public:
@@ -172,7 +219,8 @@ namespace Lykta {
 		static std::vector<MeshPtr> readMeshes(rapidjson::Document& document,
 			std::map<std::string, std::pair<unsigned, MaterialPtr> >& materials,
 			std::vector<EmitterPtr>& emitters,
-			filesystem::path& scenepath) {
+			filesystem::path& scenepath,
+			AssetCache* assets = nullptr) {
 			std::vector<MeshPtr> meshes = std::vector<MeshPtr>();
 
 			if (!document.HasMember("objects")) return meshes;
@@ -198,7 +246,7 @@ namespace Lykta {
 					continue;
 				}
 
-				std::vector<MeshPtr> imported = Mesh::openObj(filepath.str());
+				std::vector<MeshPtr> imported = (assets) ? assets->getMeshes(filepath.str()) : Mesh::openObj(filepath.str());
 				
 				// Get material
 				std::string materialLookup = std::string(mat.GetString());
@@ -209,9 +257,14 @@ namespace Lykta {
 				for (MeshPtr m : imported) {
 					if (isEmitter) {
 						EmitterPtr emitter = EmitterPtr(new MeshEmitter(m));
+						emitter->setLightGroup(materials[materialLookup].second->getLightGroup());
 						m->emitter = emitter;
 						emitters.push_back(emitter);
 					}
+					else {
+						// Cached meshes may have been emitters in an earlier scene
+						m->emitter = nullptr;
+					}
 
 					m->material = materials[materialLookup].second;
 				}
@@ -222,7 +275,8 @@ namespace Lykta {
 			return meshes;
 		}
 
-        static std::map<std::string, std::pair<unsigned, MaterialPtr>>readMaterials(rapidjson::Document& document, filesystem::path& scenepath) {
+        static std::map<std::string, std::pair<unsigned, MaterialPtr>>readMaterials(rapidjson::Document& document, filesystem::path& scenepath,
+                                                                                     std::vector<std::string>& lightGroups, AssetCache* assets = nullptr) {
 			std::map<std::string, std::pair<unsigned, MaterialPtr> > materialMap;
 
 			if (!document.HasMember("materials")) return materialMap;
@@ -269,22 +323,22 @@ namespace Lykta {
 
                 // Read textures
                 TexturePtr<glm::vec3> diffuseTexture = nullptr;
-                if (arr[i].HasMember("diffuseTexture")) diffuseTexture = readVec3Texture("diffuseTexture", arr[i], scenepath);
+                if (arr[i].HasMember("diffuseTexture")) diffuseTexture = readVec3Texture("diffuseTexture", arr[i], scenepath, assets);
 
                 TexturePtr<float> specularTexture = nullptr;
-                if (arr[i].HasMember("specularTexture")) specularTexture = readFloatTexture("specularTexture", arr[i], scenepath);
+                if (arr[i].HasMember("specularTexture")) specularTexture = readFloatTexture("specularTexture", arr[i], scenepath, assets);
 
                 TexturePtr<float> tintTexture = nullptr;
-                if (arr[i].HasMember("tintTexture")) tintTexture = readFloatTexture("tintTexture", arr[i], scenepath);
+                if (arr[i].HasMember("tintTexture")) tintTexture = readFloatTexture("tintTexture", arr[i], scenepath, assets);
 
 				TexturePtr<float> refractionTexture = nullptr;
-				if (arr[i].HasMember("refractionTexture")) refractionTexture = readFloatTexture("refractionTexture", arr[i], scenepath);
+				if (arr[i].HasMember("refractionTexture")) refractionTexture = readFloatTexture("refractionTexture", arr[i], scenepath, assets);
 
                 TexturePtr<float> roughnessTexture = nullptr;
-                if (arr[i].HasMember("roughnessTexture")) roughnessTexture = readFloatTexture("roughnessTexture", arr[i], scenepath);
+                if (arr[i].HasMember("roughnessTexture")) roughnessTexture = readFloatTexture("roughnessTexture", arr[i], scenepath, assets);
 
 				TexturePtr<float> opacityTexture = nullptr;
-				if (arr[i].HasMember("opacityTexture")) opacityTexture = readFloatTexture("opacityTexture", arr[i], scenepath);
+				if (arr[i].HasMember("opacityTexture")) opacityTexture = readFloatTexture("opacityTexture", arr[i], scenepath, assets);
 
                 // Create material
                 MaterialPtr mat = MaterialPtr(new SurfaceMaterial(diffuseColor, emissiveColor,
@@ -292,6 +346,7 @@ namespace Lykta {
                                                                   roughness, ior, twosided, diffuseTexture,
                                                                   specularTexture, tintTexture, refractionTexture,
                                                                   roughnessTexture, opacityTexture));
+				mat->setLightGroup(readLightGroup(arr[i], lightGroups));
 
 				const rapidjson::Value& name = arr[i]["name"];
 				assert(name.IsString());
@@ -363,7 +418,9 @@ namespace Lykta {
 
 		static EmitterPtr readEnvironment(rapidjson::Document& document,
 									std::vector<EmitterPtr>& emitters,
-									filesystem::path& scenepath) {
+									filesystem::path& scenepath,
+									std::vector<std::string>& lightGroups,
+									AssetCache* assets = nullptr) {
 			if (!document.HasMember("environment")) return nullptr;
 
 			const rapidjson::Value& environmentObject = document["environment"];
@@ -373,7 +430,15 @@ namespace Lykta {
 			std::string filename = environmentObject["map"].GetString();
 			// If file exists
 			if (getRealPath(filename, scenepath)) {
-				TexturePtr<glm::vec3> map = TexturePtr<glm::vec3>(new Texture<glm::vec3>(filename));
+				FilterMode filter = readFilterMode(environmentObject);
+
+				// "mapping": "latlong" (default) or "octahedral" for equal-area octahedral maps
+				EnvironmentMapping mapping = EnvironmentMapping::LATLONG;
+				if (environmentObject.HasMember("mapping") && environmentObject["mapping"].IsString()) {
+					std::string name = environmentObject["mapping"].GetString();
+					if (name == "octahedral") mapping = EnvironmentMapping::OCTAHEDRAL;
+					else if (name != "latlong") std::cout << "Unknown environment mapping: " << name << std::endl;
+				}
 				
 				float intensity = 1.f, rotation = 0.f;
 				
@@ -382,8 +447,26 @@ namespace Lykta {
 				
 				if (environmentObject.HasMember("rotation") && environmentObject["rotation"].IsFloat())
 					rotation = glm::radians(environmentObject["rotation"].GetFloat());
-				
-				EmitterPtr emitter = EmitterPtr(new EnvironmentEmitter(map, intensity, rotation));
+
+				auto create = [&]() {
+					TexturePtr<glm::vec3> map = createTexture<glm::vec3>(filename, WrapMode::REPEAT, filter, assets);
+
+					// Latlong maps wrap around horizontally but not across the poles
+					if (mapping == EnvironmentMapping::LATLONG) map->setWrapModes(WrapMode::REPEAT, WrapMode::CLAMP);
+					else map->setWrapModes(WrapMode::CLAMP, WrapMode::CLAMP);
+
+					return EmitterPtr(new EnvironmentEmitter(map, intensity, rotation, mapping));
+				};
+
+				// The sampling distribution is only rebuilt when the map or its settings change
+				EmitterPtr emitter;
+				if (assets) {
+					std::stringstream parameters;
+					parameters << (int)filter << " " << (int)mapping << " " << intensity << " " << rotation;
+					emitter = assets->getEnvironment(filename, parameters.str(), create);
+				}
+				else emitter = create();
+				emitter->setLightGroup(readLightGroup(environmentObject, lightGroups));
 				emitters.push_back(emitter);
 				return emitter;
 			}
@@ -391,5 +474,48 @@ namespace Lykta {
 				return nullptr;
 			}
 		}
+
+		// "sampler": "independent", "sobol" (default), "pmj02" or "bluenoise"
+		static Sampler::Type readSamplerType(rapidjson::Document& document) {
+			if (!document.HasMember("sampler") || !document["sampler"].IsString()) return Sampler::Type::SOBOL;
+
+			std::string name = document["sampler"].GetString();
+			if (name == "independent") return Sampler::Type::INDEPENDENT;
+			if (name == "sobol") return Sampler::Type::SOBOL;
+			if (name == "pmj02") return Sampler::Type::PMJ02;
+			if (name == "bluenoise") return Sampler::Type::BLUE_NOISE;
+
+			std::cout << "Unknown sampler: " << name << std::endl;
+			return Sampler::Type::SOBOL;
+		}
+
+		// Reads the output variables to capture, e.g.
+		// "aovs": ["albedo", "normal", "depth", "emission", "direct", "indirect", "lightgroups"]
+		// where "lightgroups" adds one output per light group
+		static std::vector<AOV> readAOVs(rapidjson::Document& document, const std::vector<std::string>& lightGroups) {
+			std::vector<AOV> aovs;
+			if (!document.HasMember("aovs")) return aovs;
+
+			const rapidjson::Value& arr = document["aovs"];
+			for (rapidjson::SizeType i = 0; i < arr.Size(); i++) {
+				if (!arr[i].IsString()) continue;
+				const std::string name = arr[i].GetString();
+
+				if (name == "albedo") aovs.push_back(AOV(AOVType::ALBEDO, name));
+				else if (name == "normal") aovs.push_back(AOV(AOVType::NORMAL, name));
+				else if (name == "depth") aovs.push_back(AOV(AOVType::DEPTH, name));
+				else if (name == "emission") aovs.push_back(AOV(AOVType::EMISSION, name));
+				else if (name == "direct") aovs.push_back(AOV(AOVType::DIRECT, name));
+				else if (name == "indirect") aovs.push_back(AOV(AOVType::INDIRECT, name));
+				else if (name == "lightgroups") {
+					for (int g = 0; g < (int)lightGroups.size(); g++) {
+						aovs.push_back(AOV(AOVType::LIGHTGROUP, "light_" + lightGroups[g], g));
+					}
+				}
+				else std::cout << "Unknown AOV: " << name << " -- skipping!" << std::endl;
+			}
+
+			return aovs;
+		}
 	};
 }
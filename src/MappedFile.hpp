@@ -0,0 +1,37 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+
+namespace Lykta {
+
+	// Read-only memory mapping of a whole file. Pages are loaded on first access,
+	// so large cached data is available immediately and shared between processes.
+	class MappedFile {
+	private:
+		const void* data = nullptr;
+		size_t size = 0;
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#endif
+
+	public:
+		MappedFile(const std::string& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool isOpen() const {
+			return data != nullptr;
+		}
+
+		const void* getData() const {
+			return data;
+		}
+
+		size_t getSize() const {
+			return size;
+		}
+	};
+}
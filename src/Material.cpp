@@ -3,27 +3,48 @@
 
 using namespace Lykta;
 
-MaterialParameters SurfaceMaterial::evalMaterialParameters(const glm::vec2& uv) const {
-    MaterialParameters params;
+void SurfaceMaterial::compile() {
+	textureBits = 0;
+	if (diffuseTexture) textureBits |= DIFFUSE_TEXTURE;
+	if (specularTexture) textureBits |= SPECULAR_TEXTURE;
+	if (tintTexture) textureBits |= TINT_TEXTURE;
+	if (refractionTexture) textureBits |= REFRACTION_TEXTURE;
+	if (roughnessTexture) textureBits |= ROUGHNESS_TEXTURE;
 
-    if (diffuseTexture) params.diffuseColor = diffuseTexture->eval(uv);
-    else params.diffuseColor = diffuseColor;
+	constantParameters.diffuseColor = diffuseColor;
+	constantParameters.specular = specular;
+	constantParameters.specularTint = specularTint;
+	constantParameters.refractivity = refractivity;
+	constantParameters.roughness = roughness;
+	constantParameters.ior = ior;
+	constantParameters.alpha = roughness * roughness;
+	constantParameters.alpha2 = constantParameters.alpha * constantParameters.alpha;
 
-    if (specularTexture) params.specular = clamp(specularTexture->eval(uv), 0.f, 1.f);
-    else params.specular = specular;
-
-    if (tintTexture) params.specularTint = clamp(tintTexture->eval(uv), 0.f, 1.f);
-    else params.specularTint = specularTint;
+	parameterFunction = parameterFunctions(std::make_integer_sequence<int, ALL_TEXTURES + 1>())[textureBits];
+}
 
-	if (refractionTexture) params.refractivity = clamp(refractionTexture->eval(uv), 0.f, 1.f);
-	else params.refractivity = refractivity;
+template <int... Bits>
+const SurfaceMaterial::ParameterFunction* SurfaceMaterial::parameterFunctions(std::integer_sequence<int, Bits...>) {
+	static const ParameterFunction functions[] = { &SurfaceMaterial::evalParameters<Bits>... };
+	return functions;
+}
 
-    if (roughnessTexture) params.roughness = clamp(roughnessTexture->eval(uv), 0.05f, 1.f);
-    else params.roughness = roughness;
+// The branches on Bits are resolved at compile time
+template <int Bits>
+MaterialParameters SurfaceMaterial::evalParameters(const SurfaceMaterial& material, const glm::vec2& uv) {
+    MaterialParameters params = material.constantParameters;
+    if (Bits == 0) return params;
 
-    params.alpha = params.roughness * params.roughness;
-    params.alpha2 = params.alpha * params.alpha;
-    params.ior = ior;
+    TexelLookup lookup(uv);
+    if (Bits & DIFFUSE_TEXTURE) params.diffuseColor = material.diffuseTexture->eval(lookup);
+    if (Bits & SPECULAR_TEXTURE) params.specular = clamp(material.specularTexture->eval(lookup), 0.f, 1.f);
+    if (Bits & TINT_TEXTURE) params.specularTint = clamp(material.tintTexture->eval(lookup), 0.f, 1.f);
+    if (Bits & REFRACTION_TEXTURE) params.refractivity = clamp(material.refractionTexture->eval(lookup), 0.f, 1.f);
+    if (Bits & ROUGHNESS_TEXTURE) {
+        params.roughness = clamp(material.roughnessTexture->eval(lookup), 0.05f, 1.f);
+        params.alpha = params.roughness * params.roughness;
+        params.alpha2 = params.alpha * params.alpha;
+    }
 
     return params;
 }
@@ -36,6 +57,12 @@ void SurfaceMaterial::evalShadingNormal(glm::vec3& normal, const glm::vec3& view
 	}
 }
 
+glm::vec3 SurfaceMaterial::evalAlbedo(const MaterialParameters& params) const {
+	glm::vec3 specularColor = (1.f - params.specularTint) * glm::vec3(1.f) + params.specularTint * params.diffuseColor;
+	glm::vec3 reflection = (1.f - params.specular) * params.diffuseColor + params.specular * specularColor;
+	return params.refractivity * glm::vec3(1.f) + (1.f - params.refractivity) * reflection;
+}
+
 glm::vec3 SurfaceMaterial::evalSpecular(SurfaceInteraction& si, const MaterialParameters& params) const {
 	if (localCosTheta(si.wo) <= 0.f || localCosTheta(si.wi) <= 0.f) {
 		si.pdf = 0.f;
@@ -162,3 +189,168 @@ glm::vec3 SurfaceMaterial::sample(const glm::vec2& sample, SurfaceInteraction& s
 		}
 	}
 }
+
+namespace {
+	// Packet version of fresnel() for light arriving from outside, cti >= 0
+	FloatN fresnelN(const FloatN& cti, const FloatN& intIOR) {
+		FloatN eta = FloatN(1.f) / intIOR;
+		FloatN stt2 = eta * eta * (FloatN(1.f) - cti * cti);
+		FloatN ctt = simd::sqrt(simd::max(FloatN(1.f) - stt2, FloatN(0.f)));
+		FloatN rs = (cti - intIOR * ctt) / (cti + intIOR * ctt);
+		FloatN rp = (intIOR * cti - ctt) / (intIOR * cti + ctt);
+		FloatN F = FloatN(0.5f) * (rs * rs + rp * rp);
+		F = simd::select(stt2 > FloatN(1.f), FloatN(1.f), F);
+		return simd::select(intIOR == FloatN(1.f), FloatN(0.f), F);
+	}
+}
+
+MaterialParametersN MaterialParametersN::load(const MaterialParameters* p) {
+	float values[9][SIMD_WIDTH];
+	for (int i = 0; i < SIMD_WIDTH; i++) {
+		values[0][i] = p[i].diffuseColor.x;
+		values[1][i] = p[i].diffuseColor.y;
+		values[2][i] = p[i].diffuseColor.z;
+		values[3][i] = p[i].specular;
+		values[4][i] = p[i].specularTint;
+		values[5][i] = p[i].refractivity;
+		values[6][i] = p[i].roughness;
+		values[7][i] = p[i].ior;
+		values[8][i] = p[i].alpha;
+	}
+
+	MaterialParametersN params;
+	params.diffuseColor = Vec3N(FloatN::load(values[0]), FloatN::load(values[1]), FloatN::load(values[2]));
+	params.specular = FloatN::load(values[3]);
+	params.specularTint = FloatN::load(values[4]);
+	params.refractivity = FloatN::load(values[5]);
+	params.roughness = FloatN::load(values[6]);
+	params.ior = FloatN::load(values[7]);
+	params.alpha = FloatN::load(values[8]);
+	params.alpha2 = params.alpha * params.alpha;
+	return params;
+}
+
+MaterialParametersN SurfaceMaterial::evalMaterialParameters(const Vec2N& uv, const MaskN& active) const {
+	if (textureBits == 0) return MaterialParametersN(constantParameters);
+
+	// Textures are looked up per lane, inactive lanes keep the constant parameters
+	float u[SIMD_WIDTH], v[SIMD_WIDTH];
+	uv.x.store(u);
+	uv.y.store(v);
+	MaterialParameters params[SIMD_WIDTH];
+	int bits = simd::toBits(active);
+	for (int i = 0; i < SIMD_WIDTH; i++) {
+		params[i] = ((bits >> i) & 1) ? parameterFunction(*this, glm::vec2(u[i], v[i])) : constantParameters;
+	}
+	return MaterialParametersN::load(params);
+}
+
+Vec3N SurfaceMaterial::evalAlbedo(const MaterialParametersN& params) const {
+	Vec3N specularColor = Vec3N(FloatN(1.f) - params.specularTint) + params.specularTint * params.diffuseColor;
+	Vec3N reflection = (FloatN(1.f) - params.specular) * params.diffuseColor + params.specular * specularColor;
+	return Vec3N(params.refractivity) + (FloatN(1.f) - params.refractivity) * reflection;
+}
+
+Vec3N SurfaceMaterial::evalSpecular(SurfaceInteractionN& si, const MaterialParametersN& params) const {
+	MaskN valid = (si.wo.z > FloatN(0.f)) & (si.wi.z > FloatN(0.f));
+
+	Vec3N wh = simd::normalize(si.wi + si.wo);
+	FloatN nh = wh.z;
+	FloatN ni = si.wi.z;
+	FloatN no = si.wo.z;
+
+	FloatN tmp = nh * nh * (params.alpha2 - FloatN(1.f)) + FloatN(1.f);
+	FloatN D = params.alpha2 / (FloatN(M_PI) * tmp * tmp);
+
+	FloatN F = fresnelN(simd::abs(simd::dot(si.wo, wh)), params.ior);
+
+	FloatN oneMinusAlpha2 = FloatN(1.f) - params.alpha2;
+	FloatN denom1 = no * simd::sqrt(params.alpha2 + oneMinusAlpha2 * ni * ni);
+	FloatN denom2 = ni * simd::sqrt(params.alpha2 + oneMinusAlpha2 * no * no);
+	FloatN G = FloatN(2.f) * ni * no / (denom1 + denom2);
+
+	FloatN denom = FloatN(1.f) / (FloatN(4.f) * simd::abs(ni * no));
+
+	Vec3N color = Vec3N(FloatN(1.f) - params.specularTint) + params.specularTint * params.diffuseColor;
+	FloatN pdf = nh * D / (FloatN(4.f) * simd::dot(si.wi, wh));
+
+	si.pdf = simd::select(valid, pdf, FloatN(0.f));
+	return simd::select(valid, (D * F * G * denom) * color, Vec3N(FloatN(0.f)));
+}
+
+Vec3N SurfaceMaterial::evalDiffuse(SurfaceInteractionN& si, const MaterialParametersN& params) const {
+	MaskN valid = (si.wo.z > FloatN(0.f)) & (si.wi.z > FloatN(0.f));
+	si.pdf = simd::select(valid, si.wo.z * FloatN(INV_PI), FloatN(0.f));
+	return simd::select(valid, FloatN(INV_PI) * params.diffuseColor, Vec3N(FloatN(0.f)));
+}
+
+Vec3N SurfaceMaterial::sampleSpecular(const Vec2N& sample, SurfaceInteractionN& si, const MaterialParametersN& params) const {
+	Vec3N wh = Sampling::GGX(sample, params.alpha);
+	si.wo = -si.wi + (FloatN(2.f) * simd::dot(si.wi, wh)) * wh;
+	Vec3N eval = evalSpecular(si, params);
+
+	MaskN valid = si.pdf >= FloatN(FLT_EPS);
+	si.pdf = simd::select(valid, si.pdf, FloatN(0.f));
+	return simd::select(valid, eval * (si.wo.z / si.pdf), Vec3N(FloatN(0.f)));
+}
+
+Vec3N SurfaceMaterial::sampleDiffuse(const Vec2N& sample, SurfaceInteractionN& si, const MaterialParametersN& params) const {
+	si.wo = Sampling::cosineHemisphere(sample);
+	si.pdf = si.wo.z * FloatN(INV_PI);
+
+	MaskN valid = si.pdf >= FloatN(FLT_EPS);
+	si.pdf = simd::select(valid, si.pdf, FloatN(0.f));
+	return simd::select(valid, params.diffuseColor, Vec3N(FloatN(0.f)));
+}
+
+Vec3N SurfaceMaterial::evaluate(SurfaceInteractionN& si, const MaterialParametersN& params) const {
+	Vec3N diffuseEval = evalDiffuse(si, params);
+	FloatN diffusePdf = si.pdf;
+	Vec3N specularEval = evalSpecular(si, params);
+	FloatN specularPdf = si.pdf;
+
+	// Refraction is not implemented yet and contributes nothing, as in the scalar path
+	FloatN reflectivity = FloatN(1.f) - params.refractivity;
+	FloatN pdf = reflectivity * ((FloatN(1.f) - params.specular) * diffusePdf + params.specular * specularPdf);
+	Vec3N eval = reflectivity * ((FloatN(1.f) - params.specular) * diffuseEval + params.specular * specularEval);
+
+	MaskN valid = pdf >= FloatN(FLT_EPS);
+	si.pdf = simd::select(valid, pdf, FloatN(0.f));
+	return simd::select(valid, eval, Vec3N(FloatN(0.f)));
+}
+
+// Lanes pick their lobe with the same sample remapping as the scalar version.
+// A lobe is only sampled if any lane picked it, and the results are blended.
+Vec3N SurfaceMaterial::sample(const Vec2N& sample, SurfaceInteractionN& si, const MaterialParametersN& params) const {
+	MaskN refracted = sample.y < params.refractivity;
+	MaskN specularLobe = ~refracted & (sample.x < params.specular);
+	MaskN diffuseLobe = ~refracted & ~specularLobe;
+
+	FloatN sy = (sample.y - params.refractivity) / (FloatN(1.f) - params.refractivity);
+
+	// Refracted lanes keep their direction and have zero pdf until refraction exists
+	Vec3N result = Vec3N(FloatN(0.f));
+	Vec3N wo = si.wo;
+	FloatN pdf = FloatN(0.f);
+
+	if (simd::any(specularLobe)) {
+		SurfaceInteractionN specularSi = si;
+		Vec3N color = sampleSpecular(Vec2N(sample.x / params.specular, sy), specularSi, params);
+		result = simd::select(specularLobe, color, result);
+		wo = simd::select(specularLobe, specularSi.wo, wo);
+		pdf = simd::select(specularLobe, specularSi.pdf, pdf);
+	}
+
+	if (simd::any(diffuseLobe)) {
+		SurfaceInteractionN diffuseSi = si;
+		FloatN sx = (sample.x - params.specular) / (FloatN(1.f) - params.specular);
+		Vec3N color = sampleDiffuse(Vec2N(sx, sy), diffuseSi, params);
+		result = simd::select(diffuseLobe, color, result);
+		wo = simd::select(diffuseLobe, diffuseSi.wo, wo);
+		pdf = simd::select(diffuseLobe, diffuseSi.pdf, pdf);
+	}
+
+	si.wo = wo;
+	si.pdf = pdf;
+	return result;
+}
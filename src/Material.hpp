@@ -1,7 +1,9 @@
 #pragma once
 
+#include <utility>
 #include "common.h"
 #include "Texture.hpp"
+#include "SIMD.hpp"
 
 namespace Lykta {
 	// All in local shading space where z axis is along normal
@@ -27,8 +29,50 @@ namespace Lykta {
         float alpha2;
     };
 
+	// Structure of arrays versions of the above for SIMD_WIDTH shading points,
+	// used by the packet functions of SurfaceMaterial
+	struct SurfaceInteractionN {
+		Vec3N wo;
+		Vec3N wi;
+		FloatN pdf;
+	};
+
+	struct MaterialParametersN {
+		Vec3N diffuseColor;
+		FloatN specular;
+		FloatN specularTint;
+		FloatN refractivity;
+		FloatN roughness;
+		FloatN ior;
+		FloatN alpha;
+		FloatN alpha2;
+
+		MaterialParametersN() {}
+
+		// Same parameters in every lane
+		MaterialParametersN(const MaterialParameters& p) : diffuseColor(p.diffuseColor), specular(p.specular),
+			specularTint(p.specularTint), refractivity(p.refractivity), roughness(p.roughness), ior(p.ior),
+			alpha(p.alpha), alpha2(p.alpha2) {}
+
+		// Transposes SIMD_WIDTH parameters into lanes
+		static MaterialParametersN load(const MaterialParameters* p);
+	};
+
 	class SurfaceMaterial {
+	public:
+		// Shading textures a material has
+		enum TextureBits {
+			DIFFUSE_TEXTURE = 1,
+			SPECULAR_TEXTURE = 2,
+			TINT_TEXTURE = 4,
+			REFRACTION_TEXTURE = 8,
+			ROUGHNESS_TEXTURE = 16,
+			ALL_TEXTURES = 31
+		};
+
 	private:
+		typedef MaterialParameters (*ParameterFunction)(const SurfaceMaterial&, const glm::vec2&);
+
         // Constant parameters
 		glm::vec3 diffuseColor;
         glm::vec3 emissiveColor;
@@ -43,6 +87,9 @@ namespace Lykta {
 
 		bool isTwoSided;
 
+		// Index of the light group the emission of this material belongs to
+		int lightGroup = -1;
+
         // Textures
         TexturePtr<glm::vec3> diffuseTexture;
         TexturePtr<float> specularTexture;
@@ -51,6 +98,21 @@ namespace Lykta {
         TexturePtr<float> roughnessTexture;
 		TexturePtr<float> opacityTexture;
 
+		// Parameter evaluation is specialized on the texture bits when the material
+		// is created. Untextured parameters are precomputed, textured ones start from
+		// them and only look up their own textures.
+		int textureBits;
+		MaterialParameters constantParameters;
+		ParameterFunction parameterFunction;
+
+		void compile();
+
+		template <int Bits>
+		static MaterialParameters evalParameters(const SurfaceMaterial& material, const glm::vec2& uv);
+
+		template <int... Bits>
+		static const ParameterFunction* parameterFunctions(std::integer_sequence<int, Bits...>);
+
 	public:
 		SurfaceMaterial(const glm::vec3& diffuse, const glm::vec3& emission, float spec, float spectint, float refr, float rough, float ior_, bool twosided) {
 			diffuseColor = diffuse;
@@ -72,6 +134,8 @@ namespace Lykta {
 			refractionTexture = nullptr;
             roughnessTexture = nullptr;
 			opacityTexture = nullptr;
+
+			compile();
 		};
 
         SurfaceMaterial(const glm::vec3 &diffuse, const glm::vec3 &emission, float spec,
@@ -97,18 +161,39 @@ namespace Lykta {
 			refractionTexture = refrTex;
             roughnessTexture = roughTex;
 			opacityTexture = opacTex;
+
+			compile();
         };
 
 		~SurfaceMaterial() {};
-		SurfaceMaterial() {};
+		SurfaceMaterial() {
+			compile();
+		};
+
+		MaterialParameters evalMaterialParameters(const glm::vec2& uv) const {
+			return parameterFunction(*this, uv);
+		}
 
-        MaterialParameters evalMaterialParameters(const glm::vec2& uv) const;
+		int getTextureBits() const {
+			return textureBits;
+		}
 		void evalShadingNormal(glm::vec3& normal, const glm::vec3& view, const glm::vec2& uv) const;
 
 		glm::vec3 getEmission() const {
 			return emissiveColor;
 		}
 
+		int getLightGroup() const {
+			return lightGroup;
+		}
+
+		void setLightGroup(int group) {
+			lightGroup = group;
+		}
+
+		// Overall reflectance color, used for albedo AOVs
+		glm::vec3 evalAlbedo(const MaterialParameters& params) const;
+
 		const TexturePtr<float> getOpacityTexture() const {
 			return opacityTexture;
 		}
@@ -124,6 +209,20 @@ namespace Lykta {
         glm::vec3 evaluate(SurfaceInteraction& si, const MaterialParameters& params) const;
         glm::vec3 sample(const glm::vec2& sample, SurfaceInteraction& si, const MaterialParameters& params) const;
 
+		// Packet versions, every lane is an independent shading point with this material.
+		// Lanes are evaluated branch free, results match the scalar functions up to
+		// the precision of the fast trigonometric functions.
+		MaterialParametersN evalMaterialParameters(const Vec2N& uv, const MaskN& active) const;
+		Vec3N evalAlbedo(const MaterialParametersN& params) const;
+
+		Vec3N evalSpecular(SurfaceInteractionN& si, const MaterialParametersN& params) const;
+		Vec3N evalDiffuse(SurfaceInteractionN& si, const MaterialParametersN& params) const;
+		Vec3N sampleSpecular(const Vec2N& sample, SurfaceInteractionN& si, const MaterialParametersN& params) const;
+		Vec3N sampleDiffuse(const Vec2N& sample, SurfaceInteractionN& si, const MaterialParametersN& params) const;
+
+		Vec3N evaluate(SurfaceInteractionN& si, const MaterialParametersN& params) const;
+		Vec3N sample(const Vec2N& sample, SurfaceInteractionN& si, const MaterialParametersN& params) const;
+
 	};
 }
 // Class for generic surface materials
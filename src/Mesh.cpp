@@ -4,6 +4,8 @@
 #include "common.h"
 #include "Mesh.hpp"
 #include "Sampling.hpp"
+#include "Statistics.hpp"
+#include "Trace.hpp"
 #include "tinyobj/tiny_obj_loader.h"
 
 using namespace Lykta;
@@ -35,6 +37,8 @@ void Mesh::setHitAttributes(RTCHit& hit, Hit& result) const {
 
 void Mesh::constructCDF() {
 	if (triangles.size() == 0) return;
+	ScopedTimer timer(Statistics::CDF_BUILD);
+	TraceScope trace("mesh CDF build");
 
 	std::vector<float> areas = std::vector<float>(triangles.size(), 0.f);
 	#pragma omp parallel for
@@ -46,27 +50,18 @@ void Mesh::constructCDF() {
 		areas[i] = glm::length(glm::cross(v1 - v0, v2 - v0)) * 0.5f;
 	}
 
-	cumulativeAreas = std::vector<float>(triangles.size(), 0.f);
-	cumulativeAreas[0] = areas[0];
-	for (int i = 1; i < triangles.size(); i++) {
-		cumulativeAreas[i] = areas[i] + cumulativeAreas[i - 1];
-	}
+	areaDistribution = Distribution1D(areas);
 }
 
 float Mesh::pdf() const {
-	if (cumulativeAreas.size() == 0) return 0.f;
-	else return 1.f / cumulativeAreas.back();
+	if (areaDistribution.size() == 0) return 0.f;
+	else return 1.f / areaDistribution.getSum();
 }
 
 void Mesh::sample(const glm::vec3& s, MeshSample& info) const {
-	int index = cumulativeAreas.size() - 1;
-	
-	// Binary search first index that is above "select" value
-	float select = s.z * cumulativeAreas.back();
-	auto it = std::lower_bound(cumulativeAreas.begin(), cumulativeAreas.end(), select);
-	if (it != cumulativeAreas.end()) {
-		index = std::distance(cumulativeAreas.begin(), it);
-	}
+	// Select triangle, the area pdf is uniform over the whole mesh
+	float trianglePDF;
+	int index = areaDistribution.sample(s.z, trianglePDF);
 	
 	// Sample barycentric coordinates
 	glm::vec3 bc = Sampling::uniformTriangle(glm::vec2(s.x, s.y));
@@ -103,6 +98,7 @@ std::vector<MeshPtr> Mesh::openObj(const std::string& filename) {
 	std::vector<tinyobj::material_t> materials;
 	std::string warning, error;
 
+	TraceScope trace("Mesh::openObj");
 	auto startTime = std::chrono::system_clock::now();
 	// Imports and triangulates obj
 	bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error, filename.c_str());
@@ -182,4 +178,42 @@ std::vector<MeshPtr> Mesh::openObj(const std::string& filename) {
 	}
 
 	return meshes;
-}
\ No newline at end of file
+}
+
+MeshPtr Mesh::createSphere(const glm::vec3& center, float radius, int rings, int segments) {
+	MeshPtr m = MeshPtr(new Mesh());
+	for (int j = 0; j <= rings; j++) {
+		float theta = M_PI * j / rings;
+		for (int i = 0; i <= segments; i++) {
+			float phi = 2 * M_PI * i / segments;
+			glm::vec3 n = glm::vec3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+			m->positions.push_back(center + radius * n);
+			m->normals.push_back(n);
+			m->texcoords.push_back(glm::vec2((float)i / segments, (float)j / rings));
+		}
+	}
+
+	// Counter-clockwise seen from outside, poles keep degenerate triangles
+	for (int j = 0; j < rings; j++) {
+		for (int i = 0; i < segments; i++) {
+			int a = j * (segments + 1) + i, b = a + 1, c = a + segments + 1, d = c + 1;
+			m->triangles.push_back({ (unsigned)a, (unsigned)b, (unsigned)d, a, b, d, a, b, d });
+			m->triangles.push_back({ (unsigned)a, (unsigned)d, (unsigned)c, a, d, c, a, d, c });
+		}
+	}
+
+	m->constructCDF();
+	return m;
+}
+
+MeshPtr Mesh::createQuad(const glm::vec3& corner, const glm::vec3& edge0, const glm::vec3& edge1) {
+	MeshPtr m = MeshPtr(new Mesh());
+	glm::vec3 n = glm::normalize(glm::cross(edge0, edge1));
+	m->positions = { corner, corner + edge0, corner + edge0 + edge1, corner + edge1 };
+	m->normals = { n, n, n, n };
+	m->texcoords = { glm::vec2(0.f, 0.f), glm::vec2(1.f, 0.f), glm::vec2(1.f, 1.f), glm::vec2(0.f, 1.f) };
+	m->triangles.push_back({ 0, 1, 2, 0, 1, 2, 0, 1, 2 });
+	m->triangles.push_back({ 0, 2, 3, 0, 2, 3, 0, 2, 3 });
+	m->constructCDF();
+	return m;
+}
@@ -2,6 +2,7 @@
 
 #include "common.h"
 #include "Material.hpp"
+#include "Distribution.hpp"
 #include <vector>
 #include <string>
 
@@ -22,7 +23,8 @@ namespace Lykta {
 		std::vector<glm::vec2> texcoords;
 		std::vector<Triangle> triangles;
 
-		std::vector<float> cumulativeAreas;
+		// Triangles are picked proportional to their area
+		Distribution1D areaDistribution;
 		EmitterPtr emitter = nullptr;
 		MaterialPtr material = nullptr;
 
@@ -39,5 +41,10 @@ namespace Lykta {
 		float pdf() const;
 
 		static std::vector<std::shared_ptr<Mesh>> openObj(const std::string& filename);
+
+		// Procedural meshes with normals and texture coordinates, e.g. for benchmarks.
+		// The sphere has 2 * rings * segments triangles, the quad two.
+		static std::shared_ptr<Mesh> createSphere(const glm::vec3& center, float radius, int rings, int segments);
+		static std::shared_ptr<Mesh> createQuad(const glm::vec3& corner, const glm::vec3& edge0, const glm::vec3& edge1);
 	};
 }
\ No newline at end of file
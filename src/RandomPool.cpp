@@ -1,3 +0,0 @@
-#include "RandomPool.hpp"
-
-std::vector<Lykta::RandomSampler> Lykta::RND::samplers;
\ No newline at end of file
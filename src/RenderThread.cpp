@@ -0,0 +1,67 @@
+#include "RenderThread.hpp"
+
+using namespace Lykta;
+
+RenderThread::RenderThread(Renderer& r) : renderer(r), running(true), waiting(0), hasFrame(false) {
+	worker = std::thread(&RenderThread::loop, this);
+}
+
+RenderThread::~RenderThread() {
+	{
+		std::lock_guard<std::mutex> lock(rendererMutex);
+		running = false;
+	}
+	renderer.cancel();
+	wakeUp.notify_all();
+	worker.join();
+	renderer.resetCancel();
+}
+
+void RenderThread::loop() {
+	while (running) {
+		if (waiting > 0) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(rendererMutex);
+		if (!running) break;
+		if (!renderer.isSceneOpen()) {
+			wakeUp.wait(lock, [this]() { return !running || renderer.isSceneOpen(); });
+			continue;
+		}
+
+		if (renderer.renderFrame()) {
+			frames.getBack().convert(renderer.getImage());
+			frames.publish();
+		}
+	}
+}
+
+void RenderThread::edit(const std::function<void()>& change) {
+	waiting++;
+	renderer.cancel();
+	{
+		std::lock_guard<std::mutex> lock(rendererMutex);
+		renderer.resetCancel();
+		change();
+	}
+	waiting--;
+	wakeUp.notify_one();
+}
+
+void RenderThread::access(const std::function<void()>& f) {
+	waiting++;
+	{
+		std::lock_guard<std::mutex> lock(rendererMutex);
+		f();
+	}
+	waiting--;
+	wakeUp.notify_one();
+}
+
+const DisplayFrame* RenderThread::latestFrame(bool& isNew) {
+	isNew = frames.update();
+	hasFrame = hasFrame || isNew;
+	return (hasFrame) ? &frames.getFront() : nullptr;
+}
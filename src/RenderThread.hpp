@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "Renderer.hpp"
+#include "TripleBuffer.hpp"
+#include "DisplayFrame.hpp"
+
+namespace Lykta {
+
+	// Renders frames on a background thread so that the GUI never waits for a
+	// pass. Finished passes are converted for display on the worker and
+	// published through a triple buffer. All other
+	// access to the renderer has to go through edit or access, which run on the
+	// calling thread while the worker is paused.
+	class RenderThread {
+	private:
+		Renderer& renderer;
+		std::thread worker;
+		std::mutex rendererMutex;
+		std::condition_variable wakeUp;
+		std::atomic<bool> running;
+		// Number of threads waiting for the renderer, the worker lets them go first
+		std::atomic<int> waiting;
+		TripleBuffer<DisplayFrame> frames;
+		bool hasFrame;
+
+		void loop();
+
+	public:
+		RenderThread(Renderer& r);
+		~RenderThread();
+
+		// Cancels the running pass, then applies change. Changes are expected to
+		// refresh the renderer, as the cancelled pass is left half accumulated.
+		void edit(const std::function<void()>& change);
+
+		// Waits for the running pass to finish, then calls f, e.g. to save the image
+		void access(const std::function<void()>& f);
+
+		// Latest finished pass or nullptr before the first one. isNew tells whether it
+		// changed since the last call. The frame stays valid until the next call.
+		const DisplayFrame* latestFrame(bool& isNew);
+	};
+}
@@ -1,7 +1,8 @@
 #include <random>
 #include <iostream>
 #include "Renderer.hpp"
-#include "RandomPool.hpp"
+#include "Statistics.hpp"
+#include "Trace.hpp"
 #include "omp.h"
 
 using namespace Lykta;
@@ -10,17 +11,86 @@ Renderer::Renderer() {
 	resolution = glm::ivec2(800, 800);
 	image = Image<glm::vec3>(resolution.x, resolution.y);
 	integratorType = Integrator::Type::PT;
+	samplerType = Sampler::Type::SOBOL;
+	seed = 0;
+	firstSample = 0;
+	materialSorting = true;
+	cancelRequested = false;
+	progressive = false;
+	previewScale = 1;
+	secondsPerPath = 0.0;
+	albedoAOV = normalAOV = -1;
 }
 
-void Renderer::openScene(const std::string& filename) {
-	scene = Scene::parseFile(filename);
+void Renderer::openScene(const std::string& filename, std::shared_ptr<AssetCache> assets) {
+	TraceScope trace("Renderer::openScene");
+	// Statistics cover one scene
+	Statistics::reset();
+	std::shared_ptr<Scene> opened;
+	{
+		ScopedTimer timer(Statistics::SCENE_LOAD);
+		opened = Scene::parseFile(filename, assets);
+	}
+	setScene(opened);
+}
+
+void Renderer::setScene(std::shared_ptr<Scene> s) {
+	scene = s;
+	secondsPerPath = 0.0;
 	resolution = scene->getResolution();
+	samplerType = scene->getSamplerType();
 	image = Image<glm::vec3>(resolution.x, resolution.y);
+	setupAOVs();
 	refresh();
 }
 
-void Renderer::refresh() {
+void Renderer::setupAOVs() {
+	aovs = scene->getAOVs();
+	albedoAOV = normalAOV = -1;
+	for (size_t k = 0; k < aovs.size(); k++) {
+		if (aovs[k].type == AOVType::ALBEDO && albedoAOV < 0) albedoAOV = (int)k;
+		if (aovs[k].type == AOVType::NORMAL && normalAOV < 0) normalAOV = (int)k;
+	}
+
+	// The denoiser needs the guide AOVs even if the scene does not output them
+	if (denoiser) {
+		if (albedoAOV < 0) {
+			albedoAOV = (int)aovs.size();
+			aovs.push_back(AOV(AOVType::ALBEDO, "albedo"));
+		}
+		if (normalAOV < 0) {
+			normalAOV = (int)aovs.size();
+			aovs.push_back(AOV(AOVType::NORMAL, "normal"));
+		}
+	}
+
+	aovImages.assign(aovs.size(), Image<glm::vec3>(resolution.x, resolution.y));
+}
+
+void Renderer::setDenoising(bool enable) {
+	if (enable == isDenoising()) return;
+	denoiser = (enable) ? std::make_shared<Denoiser>() : nullptr;
+	if (scene) {
+		setupAOVs();
+		refresh();
+	}
+}
+
+void Renderer::postprocess() {
+	if (!scene) return;
+	const Image<glm::vec3>* albedo = (albedoAOV >= 0) ? &aovImages[albedoAOV] : nullptr;
+	const Image<glm::vec3>* normal = (normalAOV >= 0) ? &aovImages[normalAOV] : nullptr;
+	TraceScope trace("postprocess");
+	integrator->postprocess(scene, image, albedo, normal);
+}
+
+void Renderer::restart() {
 	iteration = 0;
+	previewScale = (progressive) ? initialPreviewScale() : 1;
+}
+
+void Renderer::refresh() {
+	restart();
 
 	// Select integrator
 	if (integratorType == Integrator::Type::PT) {
@@ -32,30 +102,233 @@ void Renderer::refresh() {
 	else if (integratorType == Integrator::Type::AO) {
 		integrator = std::unique_ptr<Integrator>(new AOIntegrator());
 	}
+	else if (integratorType == Integrator::Type::WAVEFRONT) {
+		integrator = std::unique_ptr<Integrator>(new WavefrontIntegrator(materialSorting));
+	}
 
-	RND::init();
+	integrator->setDenoiser(denoiser);
+	sampler = Sampler::create(samplerType, seed);
+
+	TraceScope trace("preprocess");
 	integrator->preprocess(scene);
 }
 
-void Renderer::renderFrame() {
+float Renderer::pickDistance(const glm::vec2& pixel) const {
+	Ray ray;
+	scene->getCamera()->createRay(ray, pixel + glm::vec2(0.5f), glm::vec2(0.5f));
+	Hit hit;
+	if (!scene->intersect(ray, hit)) return -1.f;
+	return glm::length(hit.pos - ray.o);
+}
+
+int Renderer::initialPreviewScale() const {
+	// Start at 1/8 resolution, or coarser if that would exceed the time to first image
+	const double budget = 0.05;
+	double paths = (double)resolution.x * resolution.y;
+	int scale = 8;
+	while (scale < 64 && secondsPerPath * paths / (scale * scale) > budget) scale *= 2;
+	return scale;
+}
+
+void Renderer::renderPreview(int scale) {
+	TraceScope trace("preview", scale);
+	glm::ivec2 blocks = (resolution + glm::ivec2(scale - 1)) / scale;
+	const std::unique_ptr<Camera>& camera = scene->getCamera();
+
+	#pragma omp parallel
+	{
+		AOVSample aov = AOVSample(scene->getLightGroups().size());
+		std::unique_ptr<Sampler> pixelSampler = sampler->clone();
+
+		#pragma omp for schedule(dynamic)
+		for (int by = 0; by < blocks.y; by++) {
+			if (cancelRequested) continue;
+			TraceScope row("preview row", by);
+
+			for (int bx = 0; bx < blocks.x; bx++) {
+				// One path through the block center, with the dimensions of a camera batch
+				glm::ivec2 corner = glm::ivec2(bx, by) * scale;
+				glm::ivec2 pixel = glm::min(corner + glm::ivec2(scale / 2), resolution - glm::ivec2(1));
+				pixelSampler->startPixelSample(pixel, firstSample, 0);
+				Ray ray;
+				glm::vec2 film = glm::vec2(pixel) + pixelSampler->get2D();
+				glm::vec3 color = camera->createRay(ray, film, pixelSampler->get2D());
+
+				aov.reset();
+				glm::vec3 result = color * integrator->evaluate(ray, scene, *pixelSampler, aov);
+
+				glm::ivec2 end = glm::min(corner + glm::ivec2(scale), resolution);
+				for (int j = corner.y; j < end.y; j++) {
+					for (int i = corner.x; i < end.x; i++) {
+						int it = j * resolution.x + i;
+						image[it] = result;
+						for (size_t k = 0; k < aovs.size(); k++) {
+							glm::vec3 value = aov.get(aovs[k]);
+							aovImages[k][it] = (aovs[k].isLighting()) ? value * color : value;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+bool Renderer::renderFrame(ImageWriter* output) {
+	ScopedTimer timer(Statistics::RENDER);
+	double startTime = omp_get_wtime();
+
+	// Previews overwrite the image and do not count as accumulated samples
+	if (previewScale > 1) {
+		renderPreview(previewScale);
+		if (cancelRequested) return false;
+		glm::ivec2 blocks = (resolution + glm::ivec2(previewScale - 1)) / previewScale;
+		secondsPerPath = (omp_get_wtime() - startTime) / ((double)blocks.x * blocks.y);
+		previewScale /= 2;
+		return true;
+	}
+
+	TraceScope pass("pass", iteration);
 	float blend = 1.f / (iteration + 1);
 
 	// Create a batch of camera rays
 	std::vector<Ray> cameraRays;
 	std::vector<glm::vec3> cameraColors;
-	scene->getCamera()->createRayBatch(cameraRays, cameraColors);
+	// Every value is derived from pixel, sample index and seed, so frames do not
+	// depend on the number of threads or the scheduling of rows
+	uint32_t sampleIndex = firstSample + iteration;
+	{
+		TraceScope trace("camera rays");
+		scene->getCamera()->createRayBatch(cameraRays, cameraColors, *sampler, sampleIndex);
+	}
+
+	bool wavefront = integrator->isWavefront();
+	if (wavefront && !cancelRequested) {
+		size_t numPixels = cameraRays.size();
+		if (frameAOVs.size() != numPixels || (numPixels > 0 && frameAOVs[0].lightGroups.size() != scene->getLightGroups().size())) {
+			frameAOVs.assign(numPixels, AOVSample(scene->getLightGroups().size()));
+		}
+		TraceScope trace("evaluateFrame");
+		if (!integrator->evaluateFrame(cameraRays, scene, *sampler, sampleIndex, resolution.x, frameRadiance, frameAOVs, cancelRequested)) {
+			return false;
+		}
+	}
 
-	#pragma omp parallel for schedule(dynamic) 
-	for (int it = 0; it < resolution.y * resolution.x; it++) {
-		int i = it % resolution.x;
-		int j = it / resolution.x;
-		
-		// Integrate
-		glm::vec3 result = cameraColors[it] * integrator->evaluate(cameraRays[it], scene);
+	#pragma omp parallel
+	{
+		AOVSample aov = AOVSample(scene->getLightGroups().size());
+		std::unique_ptr<Sampler> pixelSampler = sampler->clone();
+		std::vector<float> row;
 
-		if (iteration > 0) image[it] = (1 - blend) * image[it] + blend * result;
-		else image[it] = result;
+		#pragma omp for schedule(dynamic)
+		for (int j = 0; j < resolution.y; j++) {
+			if (cancelRequested) continue;
+			TraceScope trace("row", j);
+
+			for (int i = 0; i < resolution.x; i++) {
+				int it = j * resolution.x + i;
+
+				// Integrate, unless the whole frame was already traced
+				glm::vec3 result;
+				const AOVSample* pixelAOV = &aov;
+				if (wavefront) {
+					result = cameraColors[it] * frameRadiance[it];
+					pixelAOV = &frameAOVs[it];
+				}
+				else {
+					aov.reset();
+					pixelSampler->startPixelSample(glm::ivec2(i, j), sampleIndex, 4);
+					result = cameraColors[it] * integrator->evaluate(cameraRays[it], scene, *pixelSampler, aov);
+				}
+
+				if (iteration > 0) image[it] = (1 - blend) * image[it] + blend * result;
+				else image[it] = result;
+
+				for (size_t k = 0; k < aovs.size(); k++) {
+					glm::vec3 value = pixelAOV->get(aovs[k]);
+					if (aovs[k].isLighting()) value *= cameraColors[it];
+					Image<glm::vec3>& aovImage = aovImages[k];
+					if (iteration > 0) aovImage[it] = (1 - blend) * aovImage[it] + blend * value;
+					else aovImage[it] = value;
+				}
+			}
+
+			// Hand finished scanlines to the writer while the rest of the pass is still rendering
+			if (output) {
+				TraceScope write("write row", j);
+				gatherRow(j, row);
+				#pragma omp critical(imageOutput)
+				output->writeRows(j, 1, row.data());
+			}
+		}
 	}
 
+	if (cancelRequested) return false;
+	secondsPerPath = (omp_get_wtime() - startTime) / ((double)resolution.x * resolution.y);
 	iteration++;
-}
\ No newline at end of file
+	return true;
+}
+
+std::vector<std::string> Renderer::getChannelNames() const {
+	std::vector<std::string> names = { "R", "G", "B" };
+	if (!scene) return names;
+
+	for (const AOV& aov : scene->getAOVs()) {
+		std::vector<std::string> aovNames = aov.channelNames();
+		names.insert(names.end(), aovNames.begin(), aovNames.end());
+	}
+	return names;
+}
+
+void Renderer::gatherRow(int y, std::vector<float>& row) {
+	const std::vector<AOV>& aovs = scene->getAOVs();
+	int numChannels = 3;
+	for (const AOV& aov : aovs) numChannels += aov.numChannels();
+	row.resize((size_t)resolution.x * numChannels);
+
+	for (int i = 0; i < resolution.x; i++) {
+		int it = y * resolution.x + i;
+		float* pixel = row.data() + (size_t)i * numChannels;
+		pixel[0] = image[it].x;
+		pixel[1] = image[it].y;
+		pixel[2] = image[it].z;
+
+		int c = 3;
+		for (size_t k = 0; k < aovs.size(); k++) {
+			const glm::vec3& value = aovImages[k][it];
+			pixel[c++] = value.x;
+			if (aovs[k].numChannels() == 3) {
+				pixel[c++] = value.y;
+				pixel[c++] = value.z;
+			}
+		}
+	}
+}
+
+void Renderer::saveImage(const std::string& filename) {
+	ScopedTimer timer(Statistics::IMAGE_WRITE);
+	TraceScope trace("Renderer::saveImage");
+	const std::vector<AOV>& aovs = (scene) ? scene->getAOVs() : std::vector<AOV>();
+
+	// EXR holds the beauty image and all AOVs in one multi-channel file
+	if (!aovs.empty() && ImageWriter::supportsChannels(filename, (int)getChannelNames().size())) {
+		std::unique_ptr<ImageWriter> writer = ImageWriter::create(filename, resolution.x, resolution.y, getChannelNames());
+		if (!writer) return;
+
+		std::vector<float> row;
+		for (int j = 0; j < resolution.y; j++) {
+			gatherRow(j, row);
+			writer->writeRows(j, 1, row.data());
+		}
+		writer->close();
+		return;
+	}
+
+	// Other formats get one file per AOV next to the beauty image, e.g. render.albedo.png
+	image.save(filename);
+	size_t dot = filename.find_last_of('.');
+	std::string stem = (dot == std::string::npos) ? filename : filename.substr(0, dot);
+	std::string ext = (dot == std::string::npos) ? "" : filename.substr(dot);
+	for (size_t k = 0; k < aovs.size(); k++) {
+		aovImages[k].save(stem + "." + aovs[k].name + ext);
+	}
+}
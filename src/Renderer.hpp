@@ -1,34 +1,112 @@
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include <string>
 #include <glm/vec3.hpp>
 #include "Integrator.hpp"
 #include "Image.hpp"
+#include "ImageWriter.hpp"
 #include "Scene.hpp"
+#include "Statistics.hpp"
 
 namespace Lykta {
 	class Renderer {
 	private:
 		Image<glm::vec3> image;
+		// One image per AOV, depth is stored in the first channel. The scene's AOVs
+		// come first, followed by guide AOVs that are rendered but not saved.
+		std::vector<AOV> aovs;
+		std::vector<Image<glm::vec3>> aovImages;
+		int albedoAOV, normalAOV;
+		std::shared_ptr<Denoiser> denoiser;
 		std::shared_ptr<Scene> scene;
 		std::unique_ptr<Integrator> integrator;
 		Integrator::Type integratorType;
+		std::unique_ptr<Sampler> sampler;
+		Sampler::Type samplerType;
+		uint32_t seed;
+		// Sample index of the first frame, renders of disjoint ranges can be merged
+		uint32_t firstSample;
+		// Whether the wavefront integrator sorts hits by material
+		bool materialSorting;
 		glm::ivec2 resolution;
 		unsigned iteration;
+		std::atomic<bool> cancelRequested;
+
+		// Progressive previews render one path per block of previewScale^2 pixels
+		// before accumulation starts, halving the block size every pass
+		bool progressive;
+		int previewScale;
+		// Measured cost of one path, used to choose the first preview scale
+		double secondsPerPath;
+
+		// Per pixel results of wavefront integrators, kept between frames
+		std::vector<glm::vec3> frameRadiance;
+		std::vector<AOVSample> frameAOVs;
+
+		void setupAOVs();
+		int initialPreviewScale() const;
+		void renderPreview(int scale);
 
 	public:
 		Renderer();
 
-		void openScene(const std::string& filename);
+		// Loads through assets if given, keeping what is unchanged from the previous scene
+		void openScene(const std::string& filename, std::shared_ptr<AssetCache> assets = nullptr);
+
+		// Renders a scene that was built in memory, e.g. by the SceneGenerator
+		void setScene(std::shared_ptr<Scene> s);
 		void refresh();
+
+		// Restarts accumulation, and the previews in progressive mode, without
+		// recreating the integrator
+		void restart();
 		
-		void renderFrame();
+		// Renders one sample per pixel. If output is given, the accumulated
+		// scanlines are written to it as soon as they are finished.
+		// Returns false if the pass was cancelled.
+		bool renderFrame(ImageWriter* output = nullptr);
+
+		// Makes a running renderFrame skip its remaining rows, may be called from
+		// any thread. The accumulated image is inconsistent until the next refresh.
+		void cancel() {
+			cancelRequested = true;
+		}
+
+		void resetCancel() {
+			cancelRequested = false;
+		}
 
 		Image<glm::vec3>& getImage() {
 			return image;
 		}
 
+		// Enables the albedo and normal guided denoiser, restarts the render if a scene is open
+		void setDenoising(bool enable);
+
+		bool isDenoising() const {
+			return denoiser != nullptr;
+		}
+
+		// Finalizes the accumulated image, e.g. denoising it. Call after the last frame,
+		// further frames would accumulate on top of the processed image.
+		void postprocess();
+
+		std::vector<Image<glm::vec3>>& getAOVImages() {
+			return aovImages;
+		}
+
+		// Channel names of the beauty image followed by those of the AOVs
+		std::vector<std::string> getChannelNames() const;
+
+		// Interleaves row y of the beauty image and all AOVs in the order of getChannelNames,
+		// i.e. RGB followed by the AOVs in scene order
+		void gatherRow(int y, std::vector<float>& row);
+
+		// Saves the beauty image together with the AOVs
+		void saveImage(const std::string& filename);
+
 		const glm::ivec2& getResolution() const {
 			return resolution;
 		}
@@ -41,5 +119,58 @@ namespace Lykta {
 			integratorType = type;
 		}
 
+		Sampler::Type getSamplerType() const {
+			return samplerType;
+		}
+
+		void changeSampler(Sampler::Type type) {
+			samplerType = type;
+		}
+
+		// Both take effect on the next refresh
+		void setSeed(uint32_t s) {
+			seed = s;
+		}
+
+		void setFirstSample(uint32_t index) {
+			firstSample = index;
+		}
+
+		// Starts every refresh with coarse preview passes, for interactive use
+		void setProgressive(bool enable) {
+			progressive = enable;
+		}
+
+		// Block size of the next pass, 1 once full resolution accumulation has started
+		int getPreviewScale() const {
+			return previewScale;
+		}
+
+		glm::mat4 getCameraToWorld() const {
+			return scene->getCamera()->getCameraToWorld();
+		}
+
+		// Moves the camera of the open scene and restarts accumulation
+		void setCameraToWorld(const glm::mat4& m) {
+			scene->getCamera()->setCameraToWorld(m);
+			restart();
+		}
+
+		// Distance to the first surface seen through the center of a pixel, -1 if none
+		float pickDistance(const glm::vec2& pixel) const;
+
+		void setMaterialSorting(bool enable) {
+			materialSorting = enable;
+		}
+
+		// Report of the process wide statistics since the scene was opened, followed
+		// by those of the integrator. Only call while no frame is rendering.
+		std::string getStatistics() const {
+			std::string result = Statistics::collect().toString();
+			std::string integratorStatistics = (integrator) ? integrator->getStatistics() : "";
+			if (!integratorStatistics.empty()) result += integratorStatistics + "\n";
+			return result;
+		}
+
 	};
 }
\ No newline at end of file
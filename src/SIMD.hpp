@@ -0,0 +1,294 @@
+#pragma once
+
+#include <math.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#if defined(__AVX512F__)
+#define LYKTA_SIMD_AVX512
+#include <immintrin.h>
+#elif defined(__AVX__)
+#define LYKTA_SIMD_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LYKTA_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Lykta {
+
+	// Packets of floats in the widest registers the compiler targets: 16 lanes
+	// with AVX-512, 8 with AVX, 4 with SSE2 and one lane otherwise. Code written
+	// against FloatN and MaskN compiles to every width. The free functions live in
+	// their own namespace and are found through argument dependent lookup, so they
+	// never hide the scalar math functions for plain floats.
+	namespace simd {
+
+#if defined(LYKTA_SIMD_AVX512)
+		struct MaskN {
+			__mmask16 m;
+			MaskN() {}
+			MaskN(__mmask16 a) : m(a) {}
+			explicit MaskN(bool a) : m(a ? 0xffff : 0) {}
+		};
+
+		struct FloatN {
+			static const int Width = 16;
+			__m512 v;
+			FloatN() {}
+			FloatN(__m512 a) : v(a) {}
+			FloatN(float a) : v(_mm512_set1_ps(a)) {}
+			static FloatN load(const float* p) { return _mm512_loadu_ps(p); }
+			void store(float* p) const { _mm512_storeu_ps(p, v); }
+		};
+
+		inline int toBits(const MaskN& a) { return a.m; }
+		inline MaskN operator&(const MaskN& a, const MaskN& b) { return (__mmask16)(a.m & b.m); }
+		inline MaskN operator|(const MaskN& a, const MaskN& b) { return (__mmask16)(a.m | b.m); }
+		inline MaskN operator~(const MaskN& a) { return (__mmask16)~a.m; }
+
+		inline FloatN operator+(const FloatN& a, const FloatN& b) { return _mm512_add_ps(a.v, b.v); }
+		inline FloatN operator-(const FloatN& a, const FloatN& b) { return _mm512_sub_ps(a.v, b.v); }
+		inline FloatN operator*(const FloatN& a, const FloatN& b) { return _mm512_mul_ps(a.v, b.v); }
+		inline FloatN operator/(const FloatN& a, const FloatN& b) { return _mm512_div_ps(a.v, b.v); }
+		inline MaskN operator<(const FloatN& a, const FloatN& b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ); }
+		inline MaskN operator<=(const FloatN& a, const FloatN& b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ); }
+		inline MaskN operator>(const FloatN& a, const FloatN& b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ); }
+		inline MaskN operator>=(const FloatN& a, const FloatN& b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ); }
+		inline MaskN operator==(const FloatN& a, const FloatN& b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ); }
+
+		// a where m is set, b elsewhere
+		inline FloatN select(const MaskN& m, const FloatN& a, const FloatN& b) { return _mm512_mask_blend_ps(m.m, b.v, a.v); }
+		inline FloatN min(const FloatN& a, const FloatN& b) { return _mm512_min_ps(a.v, b.v); }
+		inline FloatN max(const FloatN& a, const FloatN& b) { return _mm512_max_ps(a.v, b.v); }
+		inline FloatN sqrt(const FloatN& a) { return _mm512_sqrt_ps(a.v); }
+
+		// Sign bit operations in the integer domain, float and/or needs AVX-512DQ
+		inline FloatN abs(const FloatN& a) {
+			return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a.v), _mm512_set1_epi32(0x7fffffff)));
+		}
+
+		inline FloatN copysign(const FloatN& a, const FloatN& b) {
+			__m512i sign = _mm512_and_si512(_mm512_castps_si512(b.v), _mm512_set1_epi32((int)0x80000000u));
+			return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(abs(a).v), sign));
+		}
+
+#elif defined(LYKTA_SIMD_AVX)
+		struct MaskN {
+			__m256 m;
+			MaskN() {}
+			MaskN(__m256 a) : m(a) {}
+			explicit MaskN(bool a) : m(_mm256_castsi256_ps(_mm256_set1_epi32(a ? -1 : 0))) {}
+		};
+
+		struct FloatN {
+			static const int Width = 8;
+			__m256 v;
+			FloatN() {}
+			FloatN(__m256 a) : v(a) {}
+			FloatN(float a) : v(_mm256_set1_ps(a)) {}
+			static FloatN load(const float* p) { return _mm256_loadu_ps(p); }
+			void store(float* p) const { _mm256_storeu_ps(p, v); }
+		};
+
+		inline int toBits(const MaskN& a) { return _mm256_movemask_ps(a.m); }
+		inline MaskN operator&(const MaskN& a, const MaskN& b) { return _mm256_and_ps(a.m, b.m); }
+		inline MaskN operator|(const MaskN& a, const MaskN& b) { return _mm256_or_ps(a.m, b.m); }
+		inline MaskN operator~(const MaskN& a) { return _mm256_xor_ps(a.m, MaskN(true).m); }
+
+		inline FloatN operator+(const FloatN& a, const FloatN& b) { return _mm256_add_ps(a.v, b.v); }
+		inline FloatN operator-(const FloatN& a, const FloatN& b) { return _mm256_sub_ps(a.v, b.v); }
+		inline FloatN operator*(const FloatN& a, const FloatN& b) { return _mm256_mul_ps(a.v, b.v); }
+		inline FloatN operator/(const FloatN& a, const FloatN& b) { return _mm256_div_ps(a.v, b.v); }
+		inline MaskN operator<(const FloatN& a, const FloatN& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+		inline MaskN operator<=(const FloatN& a, const FloatN& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+		inline MaskN operator>(const FloatN& a, const FloatN& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+		inline MaskN operator>=(const FloatN& a, const FloatN& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+		inline MaskN operator==(const FloatN& a, const FloatN& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+
+		inline FloatN select(const MaskN& m, const FloatN& a, const FloatN& b) { return _mm256_blendv_ps(b.v, a.v, m.m); }
+		inline FloatN min(const FloatN& a, const FloatN& b) { return _mm256_min_ps(a.v, b.v); }
+		inline FloatN max(const FloatN& a, const FloatN& b) { return _mm256_max_ps(a.v, b.v); }
+		inline FloatN sqrt(const FloatN& a) { return _mm256_sqrt_ps(a.v); }
+		inline FloatN abs(const FloatN& a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v); }
+
+		inline FloatN copysign(const FloatN& a, const FloatN& b) {
+			__m256 sign = _mm256_set1_ps(-0.f);
+			return _mm256_or_ps(_mm256_andnot_ps(sign, a.v), _mm256_and_ps(sign, b.v));
+		}
+
+#elif defined(LYKTA_SIMD_SSE)
+		struct MaskN {
+			__m128 m;
+			MaskN() {}
+			MaskN(__m128 a) : m(a) {}
+			explicit MaskN(bool a) : m(_mm_castsi128_ps(_mm_set1_epi32(a ? -1 : 0))) {}
+		};
+
+		struct FloatN {
+			static const int Width = 4;
+			__m128 v;
+			FloatN() {}
+			FloatN(__m128 a) : v(a) {}
+			FloatN(float a) : v(_mm_set1_ps(a)) {}
+			static FloatN load(const float* p) { return _mm_loadu_ps(p); }
+			void store(float* p) const { _mm_storeu_ps(p, v); }
+		};
+
+		inline int toBits(const MaskN& a) { return _mm_movemask_ps(a.m); }
+		inline MaskN operator&(const MaskN& a, const MaskN& b) { return _mm_and_ps(a.m, b.m); }
+		inline MaskN operator|(const MaskN& a, const MaskN& b) { return _mm_or_ps(a.m, b.m); }
+		inline MaskN operator~(const MaskN& a) { return _mm_xor_ps(a.m, MaskN(true).m); }
+
+		inline FloatN operator+(const FloatN& a, const FloatN& b) { return _mm_add_ps(a.v, b.v); }
+		inline FloatN operator-(const FloatN& a, const FloatN& b) { return _mm_sub_ps(a.v, b.v); }
+		inline FloatN operator*(const FloatN& a, const FloatN& b) { return _mm_mul_ps(a.v, b.v); }
+		inline FloatN operator/(const FloatN& a, const FloatN& b) { return _mm_div_ps(a.v, b.v); }
+		inline MaskN operator<(const FloatN& a, const FloatN& b) { return _mm_cmplt_ps(a.v, b.v); }
+		inline MaskN operator<=(const FloatN& a, const FloatN& b) { return _mm_cmple_ps(a.v, b.v); }
+		inline MaskN operator>(const FloatN& a, const FloatN& b) { return _mm_cmpgt_ps(a.v, b.v); }
+		inline MaskN operator>=(const FloatN& a, const FloatN& b) { return _mm_cmpge_ps(a.v, b.v); }
+		inline MaskN operator==(const FloatN& a, const FloatN& b) { return _mm_cmpeq_ps(a.v, b.v); }
+
+		inline FloatN select(const MaskN& m, const FloatN& a, const FloatN& b) {
+			return _mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v));
+		}
+		inline FloatN min(const FloatN& a, const FloatN& b) { return _mm_min_ps(a.v, b.v); }
+		inline FloatN max(const FloatN& a, const FloatN& b) { return _mm_max_ps(a.v, b.v); }
+		inline FloatN sqrt(const FloatN& a) { return _mm_sqrt_ps(a.v); }
+		inline FloatN abs(const FloatN& a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v); }
+
+		inline FloatN copysign(const FloatN& a, const FloatN& b) {
+			__m128 sign = _mm_set1_ps(-0.f);
+			return _mm_or_ps(_mm_andnot_ps(sign, a.v), _mm_and_ps(sign, b.v));
+		}
+
+#else
+		struct MaskN {
+			bool m;
+			MaskN() {}
+			explicit MaskN(bool a) : m(a) {}
+		};
+
+		struct FloatN {
+			static const int Width = 1;
+			float v;
+			FloatN() {}
+			FloatN(float a) : v(a) {}
+			static FloatN load(const float* p) { return *p; }
+			void store(float* p) const { *p = v; }
+		};
+
+		inline int toBits(const MaskN& a) { return a.m ? 1 : 0; }
+		inline MaskN operator&(const MaskN& a, const MaskN& b) { return MaskN(a.m && b.m); }
+		inline MaskN operator|(const MaskN& a, const MaskN& b) { return MaskN(a.m || b.m); }
+		inline MaskN operator~(const MaskN& a) { return MaskN(!a.m); }
+
+		inline FloatN operator+(const FloatN& a, const FloatN& b) { return a.v + b.v; }
+		inline FloatN operator-(const FloatN& a, const FloatN& b) { return a.v - b.v; }
+		inline FloatN operator*(const FloatN& a, const FloatN& b) { return a.v * b.v; }
+		inline FloatN operator/(const FloatN& a, const FloatN& b) { return a.v / b.v; }
+		inline MaskN operator<(const FloatN& a, const FloatN& b) { return MaskN(a.v < b.v); }
+		inline MaskN operator<=(const FloatN& a, const FloatN& b) { return MaskN(a.v <= b.v); }
+		inline MaskN operator>(const FloatN& a, const FloatN& b) { return MaskN(a.v > b.v); }
+		inline MaskN operator>=(const FloatN& a, const FloatN& b) { return MaskN(a.v >= b.v); }
+		inline MaskN operator==(const FloatN& a, const FloatN& b) { return MaskN(a.v == b.v); }
+
+		inline FloatN select(const MaskN& m, const FloatN& a, const FloatN& b) { return m.m ? a : b; }
+		inline FloatN min(const FloatN& a, const FloatN& b) { return fminf(a.v, b.v); }
+		inline FloatN max(const FloatN& a, const FloatN& b) { return fmaxf(a.v, b.v); }
+		inline FloatN sqrt(const FloatN& a) { return sqrtf(a.v); }
+		inline FloatN abs(const FloatN& a) { return fabsf(a.v); }
+		inline FloatN copysign(const FloatN& a, const FloatN& b) { return copysignf(a.v, b.v); }
+#endif
+
+		const int SIMD_WIDTH = FloatN::Width;
+
+		inline FloatN operator-(const FloatN& a) { return FloatN(0.f) - a; }
+		inline FloatN& operator+=(FloatN& a, const FloatN& b) { return a = a + b; }
+		inline FloatN& operator-=(FloatN& a, const FloatN& b) { return a = a - b; }
+		inline FloatN& operator*=(FloatN& a, const FloatN& b) { return a = a * b; }
+		inline MaskN& operator&=(MaskN& a, const MaskN& b) { return a = a & b; }
+		inline MaskN& operator|=(MaskN& a, const MaskN& b) { return a = a | b; }
+
+		inline bool any(const MaskN& a) { return toBits(a) != 0; }
+		inline bool all(const MaskN& a) { return toBits(a) == (1 << SIMD_WIDTH) - 1; }
+		inline bool none(const MaskN& a) { return toBits(a) == 0; }
+
+		// Lane access goes through memory, it is meant for gathering and
+		// scattering at the boundaries of packet code, not inside loops
+		inline float getLane(const FloatN& a, int lane) {
+			float values[SIMD_WIDTH];
+			a.store(values);
+			return values[lane];
+		}
+
+		inline void setLane(FloatN& a, int lane, float value) {
+			float values[SIMD_WIDTH];
+			a.store(values);
+			values[lane] = value;
+			a = FloatN::load(values);
+		}
+
+		inline bool getLane(const MaskN& a, int lane) {
+			return (toBits(a) >> lane) & 1;
+		}
+
+		// Mask of the first count lanes, for the tail of a partially filled packet
+		inline MaskN firstLanes(int count) {
+			float index[SIMD_WIDTH];
+			for (int i = 0; i < SIMD_WIDTH; i++) index[i] = (float)i;
+			return FloatN::load(index) < FloatN((float)count);
+		}
+
+		struct Vec2N {
+			FloatN x, y;
+			Vec2N() {}
+			Vec2N(const FloatN& a, const FloatN& b) : x(a), y(b) {}
+			Vec2N(const glm::vec2& a) : x(a.x), y(a.y) {}
+
+			glm::vec2 lane(int i) const {
+				return glm::vec2(getLane(x, i), getLane(y, i));
+			}
+		};
+
+		struct Vec3N {
+			FloatN x, y, z;
+			Vec3N() {}
+			Vec3N(const FloatN& a) : x(a), y(a), z(a) {}
+			Vec3N(const FloatN& a, const FloatN& b, const FloatN& c) : x(a), y(b), z(c) {}
+			Vec3N(const glm::vec3& a) : x(a.x), y(a.y), z(a.z) {}
+
+			glm::vec3 lane(int i) const {
+				return glm::vec3(getLane(x, i), getLane(y, i), getLane(z, i));
+			}
+
+			void setLane(int i, const glm::vec3& value) {
+				simd::setLane(x, i, value.x);
+				simd::setLane(y, i, value.y);
+				simd::setLane(z, i, value.z);
+			}
+		};
+
+		inline Vec3N operator+(const Vec3N& a, const Vec3N& b) { return Vec3N(a.x + b.x, a.y + b.y, a.z + b.z); }
+		inline Vec3N operator-(const Vec3N& a, const Vec3N& b) { return Vec3N(a.x - b.x, a.y - b.y, a.z - b.z); }
+		inline Vec3N operator-(const Vec3N& a) { return Vec3N(-a.x, -a.y, -a.z); }
+		inline Vec3N operator*(const Vec3N& a, const Vec3N& b) { return Vec3N(a.x * b.x, a.y * b.y, a.z * b.z); }
+		inline Vec3N operator*(const FloatN& a, const Vec3N& b) { return Vec3N(a * b.x, a * b.y, a * b.z); }
+		inline Vec3N operator*(const Vec3N& a, const FloatN& b) { return b * a; }
+		inline Vec3N operator/(const Vec3N& a, const FloatN& b) { return Vec3N(a.x / b, a.y / b, a.z / b); }
+
+		inline FloatN dot(const Vec3N& a, const Vec3N& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		inline Vec3N normalize(const Vec3N& a) { return a * (FloatN(1.f) / sqrt(dot(a, a))); }
+
+		inline Vec3N select(const MaskN& m, const Vec3N& a, const Vec3N& b) {
+			return Vec3N(select(m, a.x, b.x), select(m, a.y, b.y), select(m, a.z, b.z));
+		}
+	}
+
+	using simd::FloatN;
+	using simd::MaskN;
+	using simd::Vec2N;
+	using simd::Vec3N;
+	using simd::SIMD_WIDTH;
+}
@@ -0,0 +1,313 @@
+#include "Sampler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "random.h"
+
+using namespace Lykta;
+
+namespace {
+	// Largest float below one
+	const float ONE_MINUS_EPSILON = 0x1.fffffep-1f;
+
+	inline float toUnitFloat(uint32_t v) {
+		return std::min(v * 0x1p-32f, ONE_MINUS_EPSILON);
+	}
+
+	inline uint32_t reverseBits(uint32_t v) {
+		v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+		v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+		v = ((v >> 4) & 0x0f0f0f0fu) | ((v & 0x0f0f0f0fu) << 4);
+		v = ((v >> 8) & 0x00ff00ffu) | ((v & 0x00ff00ffu) << 8);
+		return (v >> 16) | (v << 16);
+	}
+
+	// Hash-based Owen scrambling (Laine and Karras 2011, Burley 2020)
+	inline uint32_t laineKarrasPermutation(uint32_t v, uint32_t seed) {
+		v += seed;
+		v ^= v * 0x6c50b47cu;
+		v ^= v * 0xb82f1e52u;
+		v ^= v * 0xc7afe638u;
+		v ^= v * 0x8d22f6e6u;
+		return v;
+	}
+
+	inline uint32_t nestedUniformScramble(uint32_t v, uint32_t seed) {
+		return reverseBits(laineKarrasPermutation(reverseBits(v), seed));
+	}
+
+	inline uint32_t hash32(uint32_t a, uint32_t b) {
+		return (uint32_t)mixBits(((uint64_t)a << 32) | b);
+	}
+
+	// Sobol direction numbers from the primitive polynomials and initial values
+	// of Joe and Kuo (new-joe-kuo-6.21201). Dimension 0 is van der Corput.
+	const int SOBOL_DIMENSIONS = 16;
+
+	struct SobolParameters {
+		int degree;
+		uint32_t polynomial;
+		uint32_t m[6];
+	};
+
+	const SobolParameters SOBOL_PARAMETERS[SOBOL_DIMENSIONS - 1] = {
+		{ 1, 0, { 1 } },
+		{ 2, 1, { 1, 3 } },
+		{ 3, 1, { 1, 3, 1 } },
+		{ 3, 2, { 1, 1, 1 } },
+		{ 4, 1, { 1, 1, 3, 3 } },
+		{ 4, 4, { 1, 3, 5, 13 } },
+		{ 5, 2, { 1, 1, 5, 5, 17 } },
+		{ 5, 4, { 1, 1, 5, 5, 5 } },
+		{ 5, 7, { 1, 1, 7, 11, 19 } },
+		{ 5, 11, { 1, 1, 5, 1, 1 } },
+		{ 5, 13, { 1, 1, 1, 3, 11 } },
+		{ 5, 14, { 1, 3, 5, 5, 31 } },
+		{ 6, 1, { 1, 3, 3, 9, 7, 49 } },
+		{ 6, 13, { 1, 1, 1, 15, 21, 21 } },
+		{ 6, 16, { 1, 3, 1, 13, 27, 49 } }
+	};
+
+	// Generator matrices folded into byte tables, so a point is four lookups
+	struct SobolTables {
+		uint32_t table[SOBOL_DIMENSIONS][4][256];
+
+		SobolTables() {
+			uint32_t v[32];
+			for (int d = 0; d < SOBOL_DIMENSIONS; d++) {
+				if (d == 0) {
+					for (int i = 0; i < 32; i++) v[i] = 1u << (31 - i);
+				}
+				else {
+					const SobolParameters& p = SOBOL_PARAMETERS[d - 1];
+					int s = p.degree;
+					for (int i = 0; i < s; i++) v[i] = p.m[i] << (31 - i);
+					for (int i = s; i < 32; i++) {
+						v[i] = v[i - s] ^ (v[i - s] >> s);
+						for (int k = 1; k < s; k++) {
+							if ((p.polynomial >> (s - 1 - k)) & 1) v[i] ^= v[i - k];
+						}
+					}
+				}
+
+				for (int byte = 0; byte < 4; byte++) {
+					for (int value = 0; value < 256; value++) {
+						uint32_t result = 0;
+						for (int bit = 0; bit < 8; bit++) {
+							if (value & (1 << bit)) result ^= v[byte * 8 + bit];
+						}
+						table[d][byte][value] = result;
+					}
+				}
+			}
+		}
+	};
+
+	const SobolTables& sobolTables() {
+		static const SobolTables tables;
+		return tables;
+	}
+
+	inline uint32_t sobol(uint32_t index, int dim) {
+		if (dim == 0) return reverseBits(index);
+		const uint32_t (*t)[256] = sobolTables().table[dim];
+		return t[0][index & 0xff] ^ t[1][(index >> 8) & 0xff] ^ t[2][(index >> 16) & 0xff] ^ t[3][index >> 24];
+	}
+
+	// Owen-scrambled 2D (0,2)-sequence with its own index shuffle
+	inline glm::vec2 shuffledSobol2D(uint32_t index, uint32_t seed) {
+		uint32_t i = nestedUniformScramble(index, seed);
+		uint32_t x = nestedUniformScramble(sobol(i, 0), hash32(seed, 1));
+		uint32_t y = nestedUniformScramble(sobol(i, 1), hash32(seed, 2));
+		return glm::vec2(toUnitFloat(x), toUnitFloat(y));
+	}
+
+	// Toroidal Gaussian energy of a binary pattern, updated incrementally
+	class VoidAndCluster {
+	private:
+		int size;
+		std::vector<float> kernel;
+		std::vector<float> energy;
+		std::vector<char> pattern;
+
+	public:
+		VoidAndCluster(int n, float sigma) : size(n), kernel(n * n), energy(n * n, 0.f), pattern(n * n, 0) {
+			for (int y = 0; y < n; y++) {
+				for (int x = 0; x < n; x++) {
+					float dx = (float)std::min(x, n - x), dy = (float)std::min(y, n - y);
+					kernel[y * n + x] = expf(-(dx * dx + dy * dy) / (2 * sigma * sigma));
+				}
+			}
+		}
+
+		void set(int p, bool value) {
+			pattern[p] = value;
+			float sign = value ? 1.f : -1.f;
+			int px = p % size, py = p / size;
+			for (int y = 0; y < size; y++) {
+				const float* row = &kernel[((y - py + size) % size) * size];
+				for (int x = 0; x < size; x++) {
+					energy[y * size + x] += sign * row[(x - px + size) % size];
+				}
+			}
+		}
+
+		bool get(int p) const {
+			return pattern[p] != 0;
+		}
+
+		// Densest set pixel or emptiest unset pixel
+		int find(bool tightestCluster) const {
+			int best = -1;
+			for (int p = 0; p < size * size; p++) {
+				if (get(p) != tightestCluster) continue;
+				if (best < 0 || (tightestCluster ? energy[p] > energy[best] : energy[p] < energy[best])) best = p;
+			}
+			return best;
+		}
+	};
+
+	// Ulichney's void-and-cluster method. Since the energies of set and unset
+	// pixels sum to a constant, the largest void is also the tightest cluster
+	// of unset pixels, so phase three continues like phase two.
+	std::vector<float> buildBlueNoiseMask(int n) {
+		int numPixels = n * n;
+		VoidAndCluster initial(n, 1.5f);
+		RandomSampler rng;
+		int ones = numPixels / 10;
+		for (int i = 0; i < ones;) {
+			int p = std::min((int)(rng.next() * numPixels), numPixels - 1);
+			if (initial.get(p)) continue;
+			initial.set(p, true);
+			i++;
+		}
+
+		// Move pixels from clusters into voids until the pattern is stable
+		while (true) {
+			int cluster = initial.find(true);
+			initial.set(cluster, false);
+			int gap = initial.find(false);
+			initial.set(gap, true);
+			if (gap == cluster) break;
+		}
+
+		std::vector<int> rank(numPixels, 0);
+		VoidAndCluster pattern = initial;
+		for (int r = ones - 1; r >= 0; r--) {
+			int cluster = pattern.find(true);
+			pattern.set(cluster, false);
+			rank[cluster] = r;
+		}
+
+		pattern = initial;
+		for (int r = ones; r < numPixels; r++) {
+			int gap = pattern.find(false);
+			pattern.set(gap, true);
+			rank[gap] = r;
+		}
+
+		std::vector<float> mask(numPixels);
+		for (int p = 0; p < numPixels; p++) mask[p] = (rank[p] + 0.5f) / numPixels;
+		return mask;
+	}
+
+	const int MASK_SIZE = 64;
+}
+
+std::unique_ptr<Sampler> Sampler::create(Type type, uint32_t seed) {
+	switch (type) {
+	case INDEPENDENT: return std::unique_ptr<Sampler>(new IndependentSampler(seed));
+	case PMJ02: return std::unique_ptr<Sampler>(new PMJ02Sampler(seed));
+	case BLUE_NOISE: return std::unique_ptr<Sampler>(new BlueNoiseSampler(seed));
+	case SOBOL:
+	default: return std::unique_ptr<Sampler>(new SobolSampler(seed));
+	}
+}
+
+float IndependentSampler::get1D() {
+	uint64_t h = hashInts(pixelSeed, sampleIndex, dimension++);
+	return toUnitFloat((uint32_t)(h >> 32));
+}
+
+glm::vec2 IndependentSampler::get2D() {
+	float x = get1D();
+	return glm::vec2(x, get1D());
+}
+
+std::unique_ptr<Sampler> IndependentSampler::clone() const {
+	return std::unique_ptr<Sampler>(new IndependentSampler(*this));
+}
+
+float SobolSampler::get1D() {
+	uint32_t dim = dimension++;
+	if (dim < SOBOL_DIMENSIONS) {
+		// One index shuffle for all dimensions keeps the points a multidimensional net
+		uint32_t index = nestedUniformScramble(sampleIndex, pixelSeed);
+		return toUnitFloat(nestedUniformScramble(sobol(index, dim), dimensionSeed(dim)));
+	}
+	return shuffledSobol2D(sampleIndex, dimensionSeed(dim)).x;
+}
+
+glm::vec2 SobolSampler::get2D() {
+	if (dimension + 1 < SOBOL_DIMENSIONS) {
+		float x = get1D();
+		return glm::vec2(x, get1D());
+	}
+
+	glm::vec2 result = shuffledSobol2D(sampleIndex, dimensionSeed(dimension));
+	dimension += 2;
+	return result;
+}
+
+std::unique_ptr<Sampler> SobolSampler::clone() const {
+	return std::unique_ptr<Sampler>(new SobolSampler(*this));
+}
+
+float PMJ02Sampler::get1D() {
+	return shuffledSobol2D(sampleIndex, dimensionSeed(dimension++)).x;
+}
+
+glm::vec2 PMJ02Sampler::get2D() {
+	glm::vec2 result = shuffledSobol2D(sampleIndex, dimensionSeed(dimension));
+	dimension += 2;
+	return result;
+}
+
+std::unique_ptr<Sampler> PMJ02Sampler::clone() const {
+	return std::unique_ptr<Sampler>(new PMJ02Sampler(*this));
+}
+
+const float* BlueNoiseSampler::mask() {
+	static const std::vector<float> values = buildBlueNoiseMask(MASK_SIZE);
+	return values.data();
+}
+
+float BlueNoiseSampler::get1D() {
+	uint32_t dim = dimension++;
+
+	// Same sequence for every pixel, scrambled by the seed only
+	float value;
+	if (dim < SOBOL_DIMENSIONS) {
+		uint32_t index = nestedUniformScramble(sampleIndex, seed);
+		value = toUnitFloat(nestedUniformScramble(sobol(index, dim), hash32(seed, dim)));
+	}
+	else {
+		value = shuffledSobol2D(sampleIndex, hash32(seed, dim)).x;
+	}
+
+	// Toroidal shift of the mask per dimension decorrelates dimensions
+	uint32_t offset = hash32(~seed, dim);
+	int x = (pixel.x + (int)(offset & 63)) & (MASK_SIZE - 1);
+	int y = (pixel.y + (int)((offset >> 6) & 63)) & (MASK_SIZE - 1);
+	value += mask()[y * MASK_SIZE + x];
+	return (value >= 1.f) ? value - 1.f : value;
+}
+
+glm::vec2 BlueNoiseSampler::get2D() {
+	float x = get1D();
+	return glm::vec2(x, get1D());
+}
+
+std::unique_ptr<Sampler> BlueNoiseSampler::clone() const {
+	return std::unique_ptr<Sampler>(new BlueNoiseSampler(*this));
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include "Hash.hpp"
+
+namespace Lykta {
+
+	// Sample values addressed by pixel, sample index and dimension. Camera ray
+	// generation consumes dimensions 0-3 (film position and lens), integrators
+	// continue at dimension 4 in a fixed order per bounce. Samplers are stateful,
+	// every thread works on its own clone.
+	class Sampler {
+	protected:
+		glm::ivec2 pixel;
+		uint32_t sampleIndex;
+		uint32_t dimension;
+		uint32_t seed;
+		// Hash of pixel and seed, set once per pixel sample
+		uint32_t pixelSeed;
+
+		// Seed of one dimension within the current pixel
+		uint32_t dimensionSeed(uint32_t dim) const {
+			return (uint32_t)mixBits(((uint64_t)pixelSeed << 32) | dim);
+		}
+
+	public:
+		enum Type {
+			INDEPENDENT = 0,
+			SOBOL = 1,
+			PMJ02 = 2,
+			BLUE_NOISE = 3
+		};
+
+		Sampler(uint32_t s) : pixel(0), sampleIndex(0), dimension(0), seed(s), pixelSeed(0) {}
+		virtual ~Sampler() {}
+
+		void startPixelSample(const glm::ivec2& p, uint32_t index, uint32_t dim = 0) {
+			pixel = p;
+			sampleIndex = index;
+			dimension = dim;
+			pixelSeed = (uint32_t)hashInts((uint32_t)p.x, (uint32_t)p.y, seed);
+		}
+
+		virtual float get1D() = 0;
+
+		// Consumes two dimensions that are stratified together
+		virtual glm::vec2 get2D() = 0;
+
+		glm::vec3 get3D() {
+			glm::vec2 xy = get2D();
+			return glm::vec3(xy, get1D());
+		}
+
+		virtual std::unique_ptr<Sampler> clone() const = 0;
+
+		static std::unique_ptr<Sampler> create(Type type, uint32_t seed = 0);
+	};
+
+	// Uncorrelated values hashed from pixel, index and dimension
+	class IndependentSampler : public Sampler {
+	public:
+		IndependentSampler(uint32_t s = 0) : Sampler(s) {}
+		virtual float get1D();
+		virtual glm::vec2 get2D();
+		virtual std::unique_ptr<Sampler> clone() const;
+	};
+
+	// Owen-scrambled Sobol sequence (Burley 2020). The first dimensions come from
+	// one multidimensional Sobol net, later ones are padded with shuffled 2D nets.
+	class SobolSampler : public Sampler {
+	public:
+		SobolSampler(uint32_t s = 0) : Sampler(s) {}
+		virtual float get1D();
+		virtual glm::vec2 get2D();
+		virtual std::unique_ptr<Sampler> clone() const;
+	};
+
+	// Progressive multi-jittered (0,2) sequence. Every pair of dimensions is an
+	// Owen-scrambled (0,2)-sequence, which has the stratification of pmj02
+	// (Helmer et al. 2021), with an independent index shuffle per pair.
+	class PMJ02Sampler : public Sampler {
+	public:
+		PMJ02Sampler(uint32_t s = 0) : Sampler(s) {}
+		virtual float get1D();
+		virtual glm::vec2 get2D();
+		virtual std::unique_ptr<Sampler> clone() const;
+	};
+
+	// All pixels share one scrambled Sobol sequence, offset per pixel and dimension
+	// by a blue noise mask. At low sample counts the error becomes blue noise,
+	// which is far less visible and easier to denoise than white noise.
+	class BlueNoiseSampler : public Sampler {
+	public:
+		BlueNoiseSampler(uint32_t s = 0) : Sampler(s) {}
+		virtual float get1D();
+		virtual glm::vec2 get2D();
+		virtual std::unique_ptr<Sampler> clone() const;
+
+		// 64x64 tileable void-and-cluster mask with values in (0, 1), built on first use
+		static const float* mask();
+	};
+}
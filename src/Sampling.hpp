@@ -3,6 +3,7 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include "common.h"
+#include "FastMath.hpp"
 
 namespace Lykta {
 
@@ -40,6 +41,23 @@ namespace Lykta {
 			return nh * D / (4 * glm::dot(wi, wh));
 		}
 
+		// Packet versions of the BSDF sampling routines above. Angles in [0, 2pi)
+		// are shifted into the domain of the fast sin and cos, which flips both signs.
+		static inline Vec3N cosineHemisphere(const Vec2N& sample) {
+			FloatN r = sqrt(sample.x);
+			FloatN phi = sample.y * FloatN(2 * M_PI) - FloatN(M_PI);
+			FloatN x = -r * FastMath::cos(phi), y = -r * FastMath::sin(phi);
+			return Vec3N(x, y, sqrt(max(FloatN(0.f), FloatN(1.f) - x * x - y * y)));
+		}
+
+		static inline Vec3N GGX(const Vec2N& sample, const FloatN& alpha) {
+			FloatN a2 = alpha * alpha;
+			FloatN cosTheta = sqrt((FloatN(1.f) - sample.x) / (sample.x * (a2 - FloatN(1.f)) + FloatN(1.f)));
+			FloatN sinTheta = sqrt(max(FloatN(0.f), FloatN(1.f) - cosTheta * cosTheta));
+			FloatN phi = sample.y * FloatN(2 * M_PI) - FloatN(M_PI);
+			return Vec3N(-sinTheta * FastMath::cos(phi), -sinTheta * FastMath::sin(phi), cosTheta);
+		}
+
 		static inline glm::vec3 uniformTriangle(const glm::vec2& sample) {
 			float su1 = sqrtf(sample.x);
 			float u = 1.f - su1, v = sample.y * su1;
@@ -61,5 +79,45 @@ namespace Lykta {
 		static inline float uniformSpherePdf(const glm::vec3& dir) {
 			return 1.f / (4 * M_PI);
 		}
+
+		// Equal-area mapping of [0, 1]^2 onto the sphere with the octahedron folded
+		// into the square and z as the pole (Clarberg 2008)
+		static inline glm::vec3 equalAreaSquareToSphere(const glm::vec2& p) {
+			float u = 2 * p.x - 1, v = 2 * p.y - 1;
+			float up = fabsf(u), vp = fabsf(v);
+
+			// Distance from the diagonal of the square is the polar angle
+			float signedDistance = 1 - (up + vp);
+			float r = 1 - fabsf(signedDistance);
+			float phi = ((r == 0) ? 1 : (vp - up) / r + 1) * M_PI / 4;
+
+			float z = copysignf(1 - r * r, signedDistance);
+			float cosPhi = copysignf(FastMath::cos(phi), u);
+			float sinPhi = copysignf(FastMath::sin(phi), v);
+			float scale = r * sqrtf(fmaxf(0.f, 2 - r * r));
+			return glm::vec3(cosPhi * scale, sinPhi * scale, z);
+		}
+
+		static inline glm::vec2 equalAreaSphereToSquare(const glm::vec3& d) {
+			float x = fabsf(d.x), y = fabsf(d.y), z = fabsf(d.z);
+			float r = sqrtf(fmaxf(0.f, 1 - z));
+
+			float a = fmaxf(x, y), b = fminf(x, y);
+			b = (a == 0) ? 0 : b / a;
+			float phi = FastMath::atanUnit(b) * 2 / M_PI;
+			if (x < y) phi = 1 - phi;
+
+			float v = phi * r;
+			float u = r - v;
+			if (d.z < 0) {
+				std::swap(u, v);
+				u = 1 - u;
+				v = 1 - v;
+			}
+
+			u = copysignf(u, d.x);
+			v = copysignf(v, d.y);
+			return glm::vec2(0.5f * (u + 1), 0.5f * (v + 1));
+		}
 	};
 }
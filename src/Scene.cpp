@@ -1,5 +1,6 @@
 #include <rapidjson/rapidjson.h>
 #include <rapidjson/document.h>
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <fstream>
@@ -7,10 +8,20 @@
 #include "common.h"
 #include "Scene.hpp"
 #include "JSONHelper.hpp"
-#include "RandomPool.hpp"
+#include "Sampler.hpp"
+#include "Statistics.hpp"
+#include "Trace.hpp"
+#include <cstring>
 
 using namespace Lykta;
 
+static inline uint64_t floatBits(float a, float b) {
+	uint32_t ua, ub;
+	memcpy(&ua, &a, sizeof(float));
+	memcpy(&ub, &b, sizeof(float));
+	return ((uint64_t)ua << 32) | ub;
+}
+
 bool Scene::intersect(const Ray& r, Hit& result) const {
 	RTCIntersectContext ctx;
 	rtcInitIntersectContext(&ctx);
@@ -55,35 +66,40 @@ bool Scene::shadowIntersect(const Ray& r) const {
 ScenePtr Scene::activeScene;
 
 // Static function for parsing a scene file
-ScenePtr Scene::parseFile(const std::string& filename) {
+ScenePtr Scene::parseFile(const std::string& filename, std::shared_ptr<AssetCache> assets) {
+	TraceScope trace("Scene::parseFile");
 	ScenePtr scene = ScenePtr(new Scene());
+	scene->assets = assets;
 
-	if (activeScene) {
-		rtcReleaseScene(activeScene->embree_scene);
-		rtcReleaseDevice(activeScene->embree_device);
-		activeScene->meshes.clear();
-		activeScene->materials.clear();
-		activeScene->emitters.clear();
-		activeScene->camera.release();
-		activeScene.reset();
-	}
-
-	std::ifstream in(filename.c_str());
-	std::stringstream sstr;
-	sstr << in.rdbuf();
+	releaseActiveScene();
+	if (assets) assets->beginScene();
 
 	rapidjson::Document jsonDocument;
-	jsonDocument.Parse(sstr.str().c_str());
-	
+	{
+		TraceScope parse("parse JSON");
+		std::ifstream in(filename.c_str());
+		std::stringstream sstr;
+		sstr << in.rdbuf();
+		jsonDocument.Parse(sstr.str().c_str());
+	}
+
 	assert(jsonDocument.IsObject());
 
 	filesystem::path scenepath = filesystem::path(filename);
 	scenepath = scenepath.parent_path();
 	
 	std::vector<EmitterPtr> emitters;
-    std::map<std::string, std::pair<unsigned, MaterialPtr> > materials = JSONHelper::readMaterials(jsonDocument, scenepath);
-	
-	scene->meshes = JSONHelper::readMeshes(jsonDocument, materials, emitters, scenepath);
+	std::vector<std::string> lightGroups;
+	std::map<std::string, std::pair<unsigned, MaterialPtr> > materials;
+	{
+		TraceScope read("read materials");
+		materials = JSONHelper::readMaterials(jsonDocument, scenepath, lightGroups, assets.get());
+	}
+
+	{
+		TraceScope read("read meshes");
+		scene->meshes = JSONHelper::readMeshes(jsonDocument, materials, emitters, scenepath, assets.get());
+	}
 
 	// Create material vector from material map used for name matching
 	unsigned numMaterials = materials.size();
@@ -92,7 +108,13 @@ ScenePtr Scene::parseFile(const std::string& filename) {
 		materialVector[it->second.first] = it->second.second;
 	}
 
-	scene->environment = JSONHelper::readEnvironment(jsonDocument, emitters, scenepath);
+	{
+		TraceScope read("read environment");
+		scene->environment = JSONHelper::readEnvironment(jsonDocument, emitters, scenepath, lightGroups, assets.get());
+	}
+	scene->lightGroups = lightGroups;
+	scene->aovs = JSONHelper::readAOVs(jsonDocument, lightGroups);
+	scene->samplerType = JSONHelper::readSamplerType(jsonDocument);
 	scene->materials = materialVector;
 	scene->emitters = emitters;
 	scene->camera = std::unique_ptr<Camera>(JSONHelper::readCamera(jsonDocument, scenepath));
@@ -101,18 +123,69 @@ ScenePtr Scene::parseFile(const std::string& filename) {
 	return scene;
 }
 
+void Scene::releaseActiveScene() {
+	if (activeScene) {
+		if (!activeScene->assets) {
+			rtcReleaseScene(activeScene->embree_scene);
+			rtcReleaseDevice(activeScene->embree_device);
+		}
+		activeScene->meshes.clear();
+		activeScene->materials.clear();
+		activeScene->emitters.clear();
+		activeScene->camera.release();
+		activeScene.reset();
+	}
+}
+
+ScenePtr Scene::create(const std::vector<MeshPtr>& meshes, std::unique_ptr<Camera> camera, EmitterPtr environment, Sampler::Type samplerType) {
+	releaseActiveScene();
+	ScenePtr scene = ScenePtr(new Scene());
+
+	// Materials in order of first use
+	for (const MeshPtr& mesh : meshes) {
+		if (std::find(scene->materials.begin(), scene->materials.end(), mesh->material) == scene->materials.end()) {
+			scene->materials.push_back(mesh->material);
+		}
+		if (!mesh->emitter && maxComponent(mesh->material->getEmission()) > 0.f) {
+			if (mesh->areaDistribution.size() == 0) mesh->constructCDF();
+			mesh->emitter = EmitterPtr(new MeshEmitter(mesh));
+			mesh->emitter->setLightGroup(mesh->material->getLightGroup());
+		}
+		if (mesh->emitter) scene->emitters.push_back(mesh->emitter);
+	}
+
+	if (environment) scene->emitters.push_back(environment);
+	scene->meshes = meshes;
+	scene->environment = environment;
+	scene->samplerType = samplerType;
+	scene->camera = std::move(camera);
+	scene->generateEmbreeScene();
+	activeScene = scene;
+	return scene;
+}
+
 void Scene::generateEmbreeScene() {
+	ScopedTimer timer(Statistics::BVH_BUILD);
+	TraceScope trace("BVH build");
+	if (assets) {
+		embree_device = assets->getDevice();
+		embree_scene = assets->commitScene(meshes, [this](const MeshPtr& mesh) { return createEmbreeGeometry(mesh); });
+		return;
+	}
+
 	embree_device = rtcNewDevice(NULL);
 	embree_scene = rtcNewScene(embree_device);
 	
 	for (unsigned i = 0; i < meshes.size(); i++) {
-		unsigned geomID = createEmbreeGeometry(meshes[i]);
+		RTCGeometry geometry = createEmbreeGeometry(meshes[i]);
+		rtcAttachGeometry(embree_scene, geometry);
+		rtcReleaseGeometry(geometry);
 	}
 
 	rtcCommitScene(embree_scene);
 }
 
-unsigned Scene::createEmbreeGeometry(MeshPtr mesh) {
+RTCGeometry Scene::createEmbreeGeometry(const MeshPtr& mesh) {
 	RTCGeometry geometry = rtcNewGeometry(embree_device, RTC_GEOMETRY_TYPE_TRIANGLE);
 	rtcSetSharedGeometryBuffer(geometry, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, (void*)mesh->positions.data(), 0, sizeof(glm::vec3), mesh->positions.size());
 	rtcSetSharedGeometryBuffer(geometry, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, (void*)mesh->triangles.data(), 0, sizeof(Triangle), mesh->triangles.size());
@@ -120,11 +193,12 @@ unsigned Scene::createEmbreeGeometry(MeshPtr mesh) {
 	
 	rtcSetGeometryIntersectFilterFunction(geometry, opacityIntersectFilter);
 	rtcSetGeometryOccludedFilterFunction(geometry, opacityIntersectFilter);
+
+	// The cached scene only builds a fast top level, each mesh gets a proper BVH
+	if (assets) rtcSetGeometryBuildQuality(geometry, RTC_BUILD_QUALITY_MEDIUM);
 	
 	rtcCommitGeometry(geometry);
-	unsigned geomID = rtcAttachGeometry(embree_scene, geometry);
-	rtcReleaseGeometry(geometry);
-	return geomID;
+	return geometry;
 }
 
 
@@ -137,6 +211,7 @@ void Scene::opacityIntersectFilter(const RTCFilterFunctionNArguments* args) {
 	float v = hit->v;
 	float w = 1.f - u - v;
 	unsigned geomID = hit->geomID;
+	Statistics::count(Statistics::OPACITY_FILTER_CALLS);
 
 	const MaterialPtr material = activeScene->getMaterial(geomID);
 	const TexturePtr<float> opacityTex = material->getOpacityTexture();
@@ -161,7 +236,11 @@ void Scene::opacityIntersectFilter(const RTCFilterFunctionNArguments* args) {
 			valid[0] = 0;
 		}
 		else {
-			float rand = RND::next1D();
+			// Hashed from the ray and primitive, so the same ray always makes the same
+			// decision no matter which thread traces it
+			uint64_t h = hashInts(floatBits(ray->org_x, ray->org_y), floatBits(ray->org_z, ray->dir_x),
+								  floatBits(ray->dir_y, ray->dir_z), ((uint64_t)geomID << 32) | hit->primID);
+			float rand = (h >> 40) * 0x1p-24f;
 			if (rand < eval) {
 				valid[0] = 1;
 			}
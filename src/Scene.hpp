@@ -9,6 +9,9 @@
 #include "Camera.hpp"
 #include "Mesh.hpp"
 #include "Material.hpp"
+#include "AOV.hpp"
+#include "Sampler.hpp"
+#include "AssetCache.hpp"
 #include "random.h"
 
 namespace Lykta {
@@ -19,15 +22,20 @@ namespace Lykta {
 		std::vector<MeshPtr> meshes;
 		std::vector<EmitterPtr> emitters;
 		EmitterPtr environment = nullptr;
+		std::vector<std::string> lightGroups;
+		std::vector<AOV> aovs;
+		Sampler::Type samplerType = Sampler::Type::SOBOL;
 		
 		// Embree specific variables
 		RTCDevice embree_device;
 		RTCScene embree_scene;
+		// Owns the Embree objects instead of the scene when the scene was loaded through it
+		std::shared_ptr<AssetCache> assets;
 		static ScenePtr activeScene;
 		
 		// Embree functions
 		void generateEmbreeScene();
-		unsigned createEmbreeGeometry(MeshPtr mesh);
+		RTCGeometry createEmbreeGeometry(const MeshPtr& mesh);
 		static void opacityIntersectFilter(const RTCFilterFunctionNArguments* args);
 
 	public:
@@ -67,11 +75,35 @@ namespace Lykta {
 			return materials;
 		}
 
+		const std::vector<std::string>& getLightGroups() const {
+			return lightGroups;
+		}
+
+		const std::vector<AOV>& getAOVs() const {
+			return aovs;
+		}
+
+		Sampler::Type getSamplerType() const {
+			return samplerType;
+		}
+
 		const std::unique_ptr<Camera>& getCamera() const {
 			return camera;
 		}
 
-		static ScenePtr parseFile(const std::string& filename);
+		// Releases the Embree objects and geometry of the active scene, only one scene is
+		// active at a time. Opening a scene releases the previous one, call this to free
+		// it earlier, e.g. before generating a large scene.
+		static void releaseActiveScene();
+
+		// Meshes, textures and environments are taken from assets when given, and
+		// only the meshes that changed since the previous scene are rebuilt in Embree
+		static ScenePtr parseFile(const std::string& filename, std::shared_ptr<AssetCache> assets = nullptr);
+
+		// Builds a scene from meshes with their materials already assigned, without a
+		// scene file. Emissive meshes get mesh emitters like in parseFile.
+		static ScenePtr create(const std::vector<MeshPtr>& meshes, std::unique_ptr<Camera> camera,
+			EmitterPtr environment = nullptr, Sampler::Type samplerType = Sampler::Type::SOBOL);
 
 		
 	};
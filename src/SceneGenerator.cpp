@@ -0,0 +1,226 @@
+#include "SceneGenerator.hpp"
+#include <algorithm>
+#include <math.h>
+#include "Emitter.hpp"
+#include "Trace.hpp"
+#include "random.h"
+
+using namespace Lykta;
+
+namespace {
+	// Independent random streams per kind of object, each object seeds its own
+	// generator from the scene seed, the stream and its index
+	enum Stream {
+		SPHERE_STREAM = 1,
+		EMITTER_STREAM = 2,
+		FOLIAGE_STREAM = 3,
+		MATERIAL_STREAM = 4
+	};
+
+	inline RandomSampler objectRandom(uint32_t seed, Stream stream, uint64_t index) {
+		RandomSampler rng;
+		rng.seed(hashInts(seed, stream, index), stream);
+		return rng;
+	}
+
+	// Cells of a random color, darkened along their borders so the pattern has
+	// detail at every texel
+	TexturePtr<glm::vec3> diffuseTexture(int size, RandomSampler& rng) {
+		ImagePtr<glm::vec3> img = ImagePtr<glm::vec3>(new Image<glm::vec3>(size, size));
+		const int cells = 16;
+		glm::vec3 colors[cells * cells];
+		for (glm::vec3& c : colors) c = glm::vec3(0.1f) + 0.8f * rng.next3D();
+
+		#pragma omp parallel for
+		for (int j = 0; j < size; j++) {
+			for (int i = 0; i < size; i++) {
+				float u = (i + 0.5f) * cells / size, v = (j + 0.5f) * cells / size;
+				float fu = u - floorf(u), fv = v - floorf(v);
+				float border = std::min(std::min(fu, 1.f - fu), std::min(fv, 1.f - fv));
+				(*img)[j * size + i] = colors[(int)v * cells + (int)u] * std::min(1.f, 0.4f + 8.f * border);
+			}
+		}
+		return TexturePtr<glm::vec3>(new Texture<glm::vec3>(img, WrapMode::REPEAT, FilterMode::BILINEAR));
+	}
+
+	TexturePtr<float> roughnessTexture(int size, RandomSampler& rng) {
+		ImagePtr<float> img = ImagePtr<float>(new Image<float>(size, size));
+		float base = 0.1f + 0.5f * rng.next();
+
+		#pragma omp parallel for
+		for (int j = 0; j < size; j++) {
+			for (int i = 0; i < size; i++) {
+				// Concentric rings, like brushed metal
+				float du = (i + 0.5f) / size - 0.5f, dv = (j + 0.5f) / size - 0.5f;
+				float r = sqrtf(du * du + dv * dv);
+				(*img)[j * size + i] = base + 0.3f * (0.5f + 0.5f * sinf(r * 200.f));
+			}
+		}
+		return TexturePtr<float>(new Texture<float>(img, WrapMode::REPEAT, FilterMode::BILINEAR));
+	}
+
+	// Elliptic leaf with a soft edge, the edge texels are stochastically transparent
+	TexturePtr<float> leafOpacity() {
+		const int size = 64;
+		ImagePtr<float> img = ImagePtr<float>(new Image<float>(size, size));
+		for (int j = 0; j < size; j++) {
+			for (int i = 0; i < size; i++) {
+				float du = ((i + 0.5f) / size - 0.5f) / 0.5f, dv = ((j + 0.5f) / size - 0.5f) / 0.25f;
+				float d = du * du + dv * dv;
+				(*img)[j * size + i] = clamp((1.f - d) / 0.2f, 0.f, 1.f);
+			}
+		}
+		return TexturePtr<float>(new Texture<float>(img, WrapMode::CLAMP, FilterMode::BILINEAR));
+	}
+
+	// Gradient from horizon to zenith, a dark ground and a sun disc at 40 degrees elevation
+	EmitterPtr skyEnvironment(int width) {
+		int height = std::max(width / 2, 1);
+		ImagePtr<glm::vec3> img = ImagePtr<glm::vec3>(new Image<glm::vec3>(width, height));
+		const glm::vec3 horizon = glm::vec3(0.8f, 0.85f, 1.f), zenith = glm::vec3(0.2f, 0.4f, 0.9f);
+		const glm::vec3 sunDir = glm::vec3(cosf(0.7f), sinf(0.7f), 0.f);
+		// At least two texels wide so small maps still resolve the sun
+		float sunCos = cosf(std::max(0.01f, 4.f * M_PI / width));
+
+		#pragma omp parallel for
+		for (int j = 0; j < height; j++) {
+			float theta = M_PI * (j + 0.5f) / height;
+			float y = cosf(theta);
+			glm::vec3 sky = (y > 0.f) ? horizon + (zenith - horizon) * sqrtf(y) : glm::vec3(0.2f);
+			for (int i = 0; i < width; i++) {
+				float phi = 2 * M_PI * (i + 0.5f) / width - M_PI;
+				glm::vec3 dir = glm::vec3(sinf(theta) * cosf(phi), y, sinf(theta) * sinf(phi));
+				(*img)[j * width + i] = (glm::dot(dir, sunDir) > sunCos) ? glm::vec3(1000.f, 900.f, 800.f) : sky;
+			}
+		}
+
+		TexturePtr<glm::vec3> map = TexturePtr<glm::vec3>(new Texture<glm::vec3>(img, WrapMode::REPEAT, FilterMode::BILINEAR));
+		map->setWrapModes(WrapMode::REPEAT, WrapMode::CLAMP);
+		return EmitterPtr(new EnvironmentEmitter(map));
+	}
+
+	// Quads of random orientation in the box [lower, upper], merged into one mesh
+	MeshPtr foliageMesh(int count, const glm::vec3& lower, const glm::vec3& upper, uint32_t seed) {
+		MeshPtr m = MeshPtr(new Mesh());
+		m->positions.resize((size_t)count * 4);
+		m->normals.resize((size_t)count * 4);
+		m->texcoords.resize((size_t)count * 4);
+		m->triangles.resize((size_t)count * 2);
+		const float size = 0.25f;
+
+		#pragma omp parallel for
+		for (int k = 0; k < count; k++) {
+			RandomSampler rng = objectRandom(seed, FOLIAGE_STREAM, k);
+			glm::vec3 center = lower + (upper - lower) * rng.next3D();
+			glm::vec3 n = glm::normalize(rng.next3D() - glm::vec3(0.5f));
+			glm::vec3 t = glm::normalize(glm::cross(n, (fabsf(n.y) < 0.9f) ? glm::vec3(0.f, 1.f, 0.f) : glm::vec3(1.f, 0.f, 0.f)));
+			glm::vec3 b = glm::cross(n, t);
+
+			size_t v = (size_t)k * 4;
+			glm::vec3 corner = center - 0.5f * size * (t + b);
+			m->positions[v + 0] = corner;
+			m->positions[v + 1] = corner + size * t;
+			m->positions[v + 2] = corner + size * (t + b);
+			m->positions[v + 3] = corner + size * b;
+			m->texcoords[v + 0] = glm::vec2(0.f, 0.f);
+			m->texcoords[v + 1] = glm::vec2(1.f, 0.f);
+			m->texcoords[v + 2] = glm::vec2(1.f, 1.f);
+			m->texcoords[v + 3] = glm::vec2(0.f, 1.f);
+			for (int c = 0; c < 4; c++) m->normals[v + c] = n;
+
+			int a = (int)v;
+			m->triangles[(size_t)k * 2 + 0] = { (unsigned)a, (unsigned)a + 1, (unsigned)a + 2, a, a + 1, a + 2, a, a + 1, a + 2 };
+			m->triangles[(size_t)k * 2 + 1] = { (unsigned)a, (unsigned)a + 2, (unsigned)a + 3, a, a + 2, a + 3, a, a + 2, a + 3 };
+		}
+
+		m->constructCDF();
+		return m;
+	}
+}
+
+ScenePtr SceneGenerator::generate(const Settings& settings) {
+	TraceScope trace("SceneGenerator::generate");
+
+	// Spheres of up to 4 * rings^2 triangles each, at most 4096 of them on a square grid
+	size_t numSpheres = std::min<size_t>(std::max<size_t>(settings.triangles / 4096, 1), 4096);
+	int rings = std::max(2, (int)roundf(sqrtf((float)(settings.triangles / numSpheres) / 4.f)));
+	int gridSize = (int)ceilf(sqrtf((float)numSpheres));
+	float extent = (float)gridSize;
+
+	// Materials, textured ones if requested
+	std::vector<MaterialPtr> materials;
+	int numMaterials = (settings.textures > 0) ? settings.textures : 8;
+	materials.resize(numMaterials);
+	#pragma omp parallel for schedule(dynamic)
+	for (int k = 0; k < numMaterials; k++) {
+		RandomSampler rng = objectRandom(settings.seed, MATERIAL_STREAM, k);
+		glm::vec3 color = glm::vec3(0.1f) + 0.8f * rng.next3D();
+		TexturePtr<glm::vec3> diffuse = nullptr;
+		TexturePtr<float> roughness = nullptr;
+		if (settings.textures > 0) {
+			diffuse = diffuseTexture(settings.textureSize, rng);
+			roughness = roughnessTexture(settings.textureSize, rng);
+		}
+		materials[k] = MaterialPtr(new SurfaceMaterial(color, glm::vec3(0.f), 0.3f, 0.f, 0.f, 0.4f, 1.5f, false,
+			diffuse, nullptr, nullptr, nullptr, roughness, nullptr));
+	}
+
+	std::vector<MeshPtr> meshes = std::vector<MeshPtr>(numSpheres);
+	{
+		TraceScope spheres("generate spheres");
+		#pragma omp parallel for schedule(dynamic)
+		for (int k = 0; k < (int)numSpheres; k++) {
+			RandomSampler rng = objectRandom(settings.seed, SPHERE_STREAM, k);
+			float radius = 0.3f + 0.15f * rng.next();
+			glm::vec3 center = glm::vec3(k % gridSize - 0.5f * (gridSize - 1), radius, k / gridSize - 0.5f * (gridSize - 1));
+			meshes[k] = Mesh::createSphere(center, radius, rings, 2 * rings);
+			meshes[k]->material = materials[k % numMaterials];
+		}
+	}
+
+	float groundSize = extent + 4.f;
+	MeshPtr ground = Mesh::createQuad(glm::vec3(-0.5f * groundSize, 0.f, -0.5f * groundSize),
+		glm::vec3(0.f, 0.f, groundSize), glm::vec3(groundSize, 0.f, 0.f));
+	ground->material = MaterialPtr(new SurfaceMaterial(glm::vec3(0.5f), glm::vec3(0.f), 0.f, 0.f, 0.f, 1.f, 1.5f, false));
+	meshes.push_back(ground);
+
+	// Emitters share one material. Smaller and dimmer with growing count, so that
+	// the total power and the look of the scene stay the same.
+	if (settings.emitters > 0) {
+		float lightArea = std::max(extent, 4.f);
+		float radius = std::min(0.15f, 0.3f * lightArea / sqrtf((float)settings.emitters));
+		float radiance = lightArea * lightArea / (settings.emitters * 4.f * M_PI * radius * radius);
+		MaterialPtr emissive = MaterialPtr(new SurfaceMaterial(glm::vec3(0.f), glm::vec3(radiance), 0.f, 0.f, 0.f, 1.f, 1.5f, false));
+		size_t first = meshes.size();
+		meshes.resize(first + settings.emitters);
+
+		#pragma omp parallel for schedule(dynamic, 64)
+		for (int k = 0; k < settings.emitters; k++) {
+			RandomSampler rng = objectRandom(settings.seed, EMITTER_STREAM, k);
+			glm::vec2 p = (rng.next2D() - glm::vec2(0.5f)) * lightArea;
+			meshes[first + k] = Mesh::createSphere(glm::vec3(p.x, 3.5f, p.y), radius, 4, 8);
+			meshes[first + k]->material = emissive;
+		}
+	}
+
+	if (settings.foliage > 0) {
+		TraceScope foliage("generate foliage");
+		MeshPtr leaves = foliageMesh(settings.foliage, glm::vec3(-0.5f * extent, 1.2f, -0.5f * extent),
+			glm::vec3(0.5f * extent, 2.8f, 0.5f * extent), settings.seed);
+		leaves->material = MaterialPtr(new SurfaceMaterial(glm::vec3(0.2f, 0.5f, 0.1f), glm::vec3(0.f), 0.f, 0.f, 0.f, 0.8f, 1.5f, true,
+			nullptr, nullptr, nullptr, nullptr, nullptr, leafOpacity()));
+		meshes.push_back(leaves);
+	}
+
+	EmitterPtr environment = nullptr;
+	if (settings.environmentWidth > 0) {
+		TraceScope sky("generate environment");
+		environment = skyEnvironment(settings.environmentWidth);
+	}
+
+	// Looking down at the grid from the front
+	glm::mat4 cameraToWorld = lookAt(glm::vec3(0.f, 0.45f * extent + 1.5f, 0.9f * extent + 2.f), glm::vec3(0.f, 0.2f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+	std::unique_ptr<Camera> camera = std::unique_ptr<Camera>(new PerspectiveCamera(cameraToWorld, settings.resolution, 45.f, 0.01f, 1e4f));
+
+	return Scene::create(meshes, std::move(camera), environment);
+}
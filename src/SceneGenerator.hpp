@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <glm/vec2.hpp>
+#include "common.h"
+#include "Scene.hpp"
+
+namespace Lykta {
+
+	// Builds scenes of configurable scale without scene files, for benchmarks.
+	// A grid of tessellated spheres stands on a ground plane, lit by small
+	// emissive spheres and optionally an environment map. Foliage is a cloud of
+	// alpha tested two-sided quads above the spheres. The same settings always
+	// give the same scene.
+	class SceneGenerator {
+	public:
+		struct Settings {
+			// Approximate triangle count of the sphere grid
+			size_t triangles = 1 << 16;
+			// Emissive spheres, their total power does not depend on the count
+			int emitters = 1;
+			// Alpha tested leaf quads
+			int foliage = 0;
+			// Number and size of the procedural diffuse and roughness texture pairs,
+			// materials are untextured if zero
+			int textures = 0;
+			int textureSize = 1024;
+			// Width of the procedural latlong sky, no environment if zero
+			int environmentWidth = 0;
+			glm::ivec2 resolution = glm::ivec2(480, 270);
+			uint32_t seed = 0;
+		};
+
+		static ScenePtr generate(const Settings& settings);
+	};
+}
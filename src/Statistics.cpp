@@ -0,0 +1,124 @@
+#include "Statistics.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+using namespace Lykta;
+
+namespace {
+	struct Registry {
+		std::mutex mutex;
+		std::vector<Statistics::ThreadCounters*> threads;
+		// Counters of threads that have exited
+		uint64_t retired[Statistics::NUM_COUNTERS] = {};
+		double seconds[Statistics::NUM_TIMERS] = {};
+	};
+
+	Registry& registry() {
+		static Registry instance;
+		return instance;
+	}
+}
+
+thread_local Statistics::ThreadCounters Statistics::local;
+
+Statistics::ThreadCounters::ThreadCounters() {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	r.threads.push_back(this);
+}
+
+Statistics::ThreadCounters::~ThreadCounters() {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	for (int c = 0; c < NUM_COUNTERS; c++) r.retired[c] += values[c];
+	r.threads.erase(std::remove(r.threads.begin(), r.threads.end(), this), r.threads.end());
+}
+
+void Statistics::addTime(Timer timer, double seconds) {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	r.seconds[timer] += seconds;
+}
+
+Statistics::Report Statistics::collect() {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	Report report;
+	for (int c = 0; c < NUM_COUNTERS; c++) {
+		report.counters[c] = r.retired[c];
+		for (const ThreadCounters* thread : r.threads) report.counters[c] += thread->values[c];
+	}
+	for (int t = 0; t < NUM_TIMERS; t++) report.seconds[t] = r.seconds[t];
+	return report;
+}
+
+void Statistics::reset() {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	for (ThreadCounters* thread : r.threads) {
+		std::fill(thread->values, thread->values + NUM_COUNTERS, 0);
+	}
+	std::fill(r.retired, r.retired + NUM_COUNTERS, 0);
+	std::fill(r.seconds, r.seconds + NUM_TIMERS, 0.0);
+}
+
+const char* Statistics::counterName(Counter counter) {
+	static const char* names[NUM_COUNTERS] = {
+		"primaryRays", "bounceRays", "shadowRays", "opacityFilterCalls", "rouletteTerminations", "neeHits"
+	};
+	return names[counter];
+}
+
+const char* Statistics::timerName(Timer timer) {
+	static const char* names[NUM_TIMERS] = {
+		"sceneLoad", "bvhBuild", "cdfBuild", "render", "imageWrite"
+	};
+	return names[timer];
+}
+
+double Statistics::Report::averagePathLength() const {
+	uint64_t paths = counters[PRIMARY_RAYS];
+	return (paths > 0) ? (double)(paths + counters[BOUNCE_RAYS]) / paths : 0.0;
+}
+
+std::string Statistics::Report::toString() const {
+	const char* labels[NUM_COUNTERS] = {
+		"Primary rays", "Bounce rays", "Shadow rays", "Opacity filter calls", "Russian roulette terminations", "NEE hits"
+	};
+	const char* timerLabels[NUM_TIMERS] = {
+		"Scene load (incl. BVH and CDF)", "BVH build", "CDF build", "Rendering", "Image write"
+	};
+
+	std::string result;
+	char line[128];
+	for (int c = 0; c < NUM_COUNTERS; c++) {
+		snprintf(line, sizeof(line), "%-32s %llu\n", labels[c], (unsigned long long)counters[c]);
+		result += line;
+	}
+	snprintf(line, sizeof(line), "%-32s %.2f rays\n", "Average path length", averagePathLength());
+	result += line;
+	for (int t = 0; t < NUM_TIMERS; t++) {
+		snprintf(line, sizeof(line), "%-32s %.3f s\n", timerLabels[t], seconds[t]);
+		result += line;
+	}
+	return result;
+}
+
+std::string Statistics::Report::toJSON() const {
+	std::string result = "{\n  \"counters\": {\n";
+	char line[128];
+	for (int c = 0; c < NUM_COUNTERS; c++) {
+		snprintf(line, sizeof(line), "    \"%s\": %llu%s\n", counterName((Counter)c), (unsigned long long)counters[c], (c + 1 < NUM_COUNTERS) ? "," : "");
+		result += line;
+	}
+	snprintf(line, sizeof(line), "  },\n  \"averagePathLength\": %.6g,\n  \"seconds\": {\n", averagePathLength());
+	result += line;
+	for (int t = 0; t < NUM_TIMERS; t++) {
+		snprintf(line, sizeof(line), "    \"%s\": %.6f%s\n", timerName((Timer)t), seconds[t], (t + 1 < NUM_TIMERS) ? "," : "");
+		result += line;
+	}
+	result += "  }\n}\n";
+	return result;
+}
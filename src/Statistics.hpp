@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <string>
+
+namespace Lykta {
+
+	// Render statistics gathered process wide. Counters are incremented without
+	// synchronization in a block owned by the calling thread, collect merges the
+	// blocks of all threads. Blocks of threads that exit are folded into the
+	// totals. collect and reset must only run while no thread is counting, e.g.
+	// between frames. Timers are coarse and added to the totals directly.
+	class Statistics {
+	public:
+		enum Counter {
+			PRIMARY_RAYS = 0,
+			BOUNCE_RAYS,
+			SHADOW_RAYS,
+			OPACITY_FILTER_CALLS,
+			ROULETTE_TERMINATIONS,
+			// Emitter samples whose shadow ray reached the emitter
+			NEE_HITS,
+			NUM_COUNTERS
+		};
+
+		enum Timer {
+			SCENE_LOAD = 0,
+			BVH_BUILD,
+			CDF_BUILD,
+			RENDER,
+			IMAGE_WRITE,
+			NUM_TIMERS
+		};
+
+		struct Report {
+			uint64_t counters[NUM_COUNTERS] = {};
+			double seconds[NUM_TIMERS] = {};
+
+			// Rays per path, every path starts with one primary ray
+			double averagePathLength() const;
+
+			// One line per counter and timer
+			std::string toString() const;
+
+			std::string toJSON() const;
+		};
+
+		struct ThreadCounters {
+			uint64_t values[NUM_COUNTERS] = {};
+
+			ThreadCounters();
+			~ThreadCounters();
+		};
+
+		static void count(Counter counter, uint64_t n = 1) {
+			local.values[counter] += n;
+		}
+
+		static void addTime(Timer timer, double seconds);
+
+		static Report collect();
+
+		static void reset();
+
+		static const char* counterName(Counter counter);
+		static const char* timerName(Timer timer);
+
+	private:
+		static thread_local ThreadCounters local;
+	};
+
+	// Adds the lifetime of the object to a timer
+	class ScopedTimer {
+	private:
+		Statistics::Timer timer;
+		std::chrono::steady_clock::time_point start;
+
+	public:
+		ScopedTimer(Statistics::Timer t) : timer(t), start(std::chrono::steady_clock::now()) {}
+
+		~ScopedTimer() {
+			Statistics::addTime(timer, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+	};
+}
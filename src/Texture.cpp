@@ -1,30 +1,136 @@
 #include "Texture.hpp"
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LYKTA_TEXTURE_SSE
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
 
 using namespace Lykta;
 
+namespace {
+
+    // Normalized coordinate in [0, 1), or (0, 1] when upper is set, computed in constant time
+    inline float wrapCoordinate(float x, WrapMode wrap, bool upper) {
+        switch (wrap) {
+        case WrapMode::CLAMP:
+            return clamp(x, 0.f, 1.f);
+        case WrapMode::MIRROR: {
+            // Period of two, second half is flipped
+            float t = x - 2.f * floorf(0.5f * x);
+            return (t <= 1.f) ? t : 2.f - t;
+        }
+        default:
+            return (upper) ? x - ceilf(x) + 1.f : x - floorf(x);
+        }
+    }
+
+    // Maps a texel coordinate of a filter tap into [0, size)
+    inline int wrapTexel(int x, int size, WrapMode wrap) {
+        switch (wrap) {
+        case WrapMode::CLAMP:
+            return std::min(std::max(x, 0), size - 1);
+        case WrapMode::MIRROR: {
+            int m = x % (2 * size);
+            if (m < 0) m += 2 * size;
+            return (m < size) ? m : 2 * size - 1 - m;
+        }
+        default: {
+            int m = x % size;
+            return (m < 0) ? m + size : m;
+        }
+        }
+    }
+
+#ifdef LYKTA_TEXTURE_SSE
+    // Conversion of texel types to and from one SSE register
+    template <typename T> struct TexelSSE;
+
+    template <> struct TexelSSE<float> {
+        static inline __m128 load(const float& v) { return _mm_set_ss(v); }
+        static inline float store(__m128 v) { return _mm_cvtss_f32(v); }
+    };
+
+    template <> struct TexelSSE<glm::vec3> {
+        static inline __m128 load(const glm::vec3& v) { return _mm_setr_ps(v.x, v.y, v.z, 0.f); }
+        static inline glm::vec3 store(__m128 v) {
+            alignas(16) float f[4];
+            _mm_store_ps(f, v);
+            return glm::vec3(f[0], f[1], f[2]);
+        }
+    };
+
+    template <> struct TexelSSE<glm::vec4> {
+        static inline __m128 load(const glm::vec4& v) { return _mm_loadu_ps(&v.x); }
+        static inline glm::vec4 store(__m128 v) {
+            glm::vec4 result;
+            _mm_storeu_ps(&result.x, v);
+            return result;
+        }
+    };
+
+    template <int i>
+    inline __m128 broadcast(__m128 v) {
+        return _mm_shuffle_ps(v, v, _MM_SHUFFLE(i, i, i, i));
+    }
+
+    inline float horizontalSum(__m128 v) {
+        __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 sums = _mm_add_ps(v, shuf);
+        shuf = _mm_movehl_ps(shuf, sums);
+        return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+    }
+
+    // Catmull-Rom weights of the four taps around t in [0, 1), evaluated with Horner's rule
+    inline __m128 cubicWeights(float t) {
+        const __m128 a = _mm_setr_ps(-0.5f, 1.5f, -1.5f, 0.5f);
+        const __m128 b = _mm_setr_ps(1.f, -2.5f, 2.f, -0.5f);
+        const __m128 c = _mm_setr_ps(-0.5f, 0.f, 0.5f, 0.f);
+        const __m128 d = _mm_setr_ps(0.f, 1.f, 0.f, 0.f);
+        __m128 tv = _mm_set1_ps(t);
+        __m128 w = _mm_add_ps(_mm_mul_ps(a, tv), b);
+        w = _mm_add_ps(_mm_mul_ps(w, tv), c);
+        return _mm_add_ps(_mm_mul_ps(w, tv), d);
+    }
+#else
+    inline void cubicWeights(float t, float w[4]) {
+        w[0] = ((-0.5f * t + 1.f) * t - 0.5f) * t;
+        w[1] = (1.5f * t - 2.5f) * t * t + 1.f;
+        w[2] = ((-1.5f * t + 2.f) * t + 0.5f) * t;
+        w[3] = (0.5f * t - 0.5f) * t * t;
+    }
+#endif
+}
+
 template<>
-Texture<glm::vec3>::Texture(const std::string &path) {
+Texture<glm::vec3>::Texture(const std::string &path, WrapMode wrapMode, FilterMode filterMode) {
     image = ImagePtr<glm::vec3>(new Image<glm::vec3>(path));
+    wrapU = wrapV = wrapMode;
+    filter = filterMode;
 }
 
 template<>
-Texture<glm::vec4>::Texture(const std::string& path) {
+Texture<glm::vec4>::Texture(const std::string& path, WrapMode wrapMode, FilterMode filterMode) {
     image = ImagePtr<glm::vec4>(new Image<glm::vec4>(path));
+    wrapU = wrapV = wrapMode;
+    filter = filterMode;
 }
 
 template<>
-Texture<float>::Texture(const std::string& path) {
+Texture<float>::Texture(const std::string& path, WrapMode wrapMode, FilterMode filterMode) {
     image = ImagePtr<float>(new Image<float>(path));
+    wrapU = wrapV = wrapMode;
+    filter = filterMode;
 }
 
+// Maps uv into [0, 1) in x and (0, 1] in y
 template<typename T>
 glm::vec2 Texture<T>::uvNormalize(const glm::vec2& uv) const {
-    glm::vec2 st = uv;
-    while (st.x < 0) st.x += 1.f;
-    while (st.y <= 0) st.y += 1.f;
-    while (st.x >= 1) st.x -= 1.f;
-    while (st.y > 1) st.y -= 1.f;
-    return st;
+    return glm::vec2(wrapCoordinate(uv.x, wrapU, false), wrapCoordinate(uv.y, wrapV, true));
 }
 
 template<typename T>
@@ -35,25 +141,164 @@ int Texture<T>::getIndex(const glm::vec2& st) const {
     return y * dims.x + x;
 }
 
-template<>
-glm::vec3 Texture<glm::vec3>::eval(const glm::vec2& uv) const {
-    glm::vec2 st = uvNormalize(uv);
-    int index = getIndex(st);
-    return image->read(index);
+template<typename T>
+void Texture<T>::computeLookup(TexelLookup& lookup) const {
+    glm::ivec2 dims = image->getDims();
+    lookup.dims = dims;
+    lookup.wrapU = wrapU;
+    lookup.wrapV = wrapV;
+    lookup.filter = filter;
+
+    glm::vec2 st = uvNormalize(lookup.uv);
+    if (filter == FilterMode::NEAREST) {
+        lookup.index = getIndex(st);
+        return;
+    }
+
+    // Filters interpolate between texel centers
+    glm::vec2 p = glm::vec2(dims.x * st.x, dims.y * (1 - st.y)) - glm::vec2(0.5f);
+    glm::vec2 base = glm::floor(p);
+    lookup.frac = p - base;
+    lookup.texel = glm::ivec2(base);
+    if (filter == FilterMode::BICUBIC) lookup.texel -= glm::ivec2(1);
 }
 
-template<>
-glm::vec4 Texture<glm::vec4>::eval(const glm::vec2& uv) const {
-    glm::vec2 st = uvNormalize(uv);
-    int index = getIndex(st);
-    return image->read(index);
+template<typename T>
+T Texture<T>::evalBilinear(const TexelLookup& lookup) const {
+    glm::ivec2 dims = lookup.dims;
+    const T* data = image->getData();
+    int x0 = lookup.texel.x, x1 = x0 + 1;
+    int y0 = lookup.texel.y, y1 = y0 + 1;
+    // Footprints away from the borders need no wrapping
+    if (x0 < 0 || x1 >= dims.x || y0 < 0 || y1 >= dims.y) {
+        x0 = wrapTexel(x0, dims.x, wrapU);
+        x1 = wrapTexel(x1, dims.x, wrapU);
+        y0 = wrapTexel(y0, dims.y, wrapV);
+        y1 = wrapTexel(y1, dims.y, wrapV);
+    }
+    y0 *= dims.x;
+    y1 *= dims.x;
+    float fx = lookup.frac.x, fy = lookup.frac.y;
+
+#ifdef LYKTA_TEXTURE_SSE
+    // Weights of taps (x0, y0), (x1, y0), (x0, y1), (x1, y1)
+    __m128 w = _mm_mul_ps(_mm_setr_ps(1.f - fx, fx, 1.f - fx, fx), _mm_setr_ps(1.f - fy, 1.f - fy, fy, fy));
+
+    if constexpr (std::is_same<T, float>::value) {
+        // All four single channel taps fit in one register
+        __m128 taps = _mm_setr_ps(data[y0 + x0], data[y0 + x1], data[y1 + x0], data[y1 + x1]);
+        return horizontalSum(_mm_mul_ps(taps, w));
+    }
+    else {
+        __m128 acc = _mm_mul_ps(TexelSSE<T>::load(data[y0 + x0]), broadcast<0>(w));
+        acc = _mm_add_ps(acc, _mm_mul_ps(TexelSSE<T>::load(data[y0 + x1]), broadcast<1>(w)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(TexelSSE<T>::load(data[y1 + x0]), broadcast<2>(w)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(TexelSSE<T>::load(data[y1 + x1]), broadcast<3>(w)));
+        return TexelSSE<T>::store(acc);
+    }
+#else
+    T top = (1.f - fx) * data[y0 + x0] + fx * data[y0 + x1];
+    T bottom = (1.f - fx) * data[y1 + x0] + fx * data[y1 + x1];
+    return (1.f - fy) * top + fy * bottom;
+#endif
 }
 
-template<>
-float Texture<float>::eval(const glm::vec2& uv) const {
-    glm::vec2 st = uvNormalize(uv);
-    int index = getIndex(st);
-    return image->read(index);
+template<typename T>
+T Texture<T>::evalBicubic(const TexelLookup& lookup) const {
+    glm::ivec2 dims = lookup.dims;
+    const T* data = image->getData();
+    int xs[4], ys[4];
+    // Footprints away from the borders need no wrapping
+    bool interior = lookup.texel.x >= 0 && lookup.texel.x + 3 < dims.x && lookup.texel.y >= 0 && lookup.texel.y + 3 < dims.y;
+    for (int i = 0; i < 4; i++) {
+        xs[i] = (interior) ? lookup.texel.x + i : wrapTexel(lookup.texel.x + i, dims.x, wrapU);
+        ys[i] = ((interior) ? lookup.texel.y + i : wrapTexel(lookup.texel.y + i, dims.y, wrapV)) * dims.x;
+    }
+
+#ifdef LYKTA_TEXTURE_SSE
+    __m128 wx = cubicWeights(lookup.frac.x);
+    __m128 wy = cubicWeights(lookup.frac.y);
+    // Catmull-Rom overshoots next to sharp edges, keep results non-negative
+    const __m128 zero = _mm_setzero_ps();
+
+    if constexpr (std::is_same<T, float>::value) {
+        // One row of four taps per register, transposed so that summing the
+        // registers gives the horizontally filtered value of each row
+        __m128 r0 = _mm_mul_ps(_mm_setr_ps(data[ys[0] + xs[0]], data[ys[0] + xs[1]], data[ys[0] + xs[2]], data[ys[0] + xs[3]]), wx);
+        __m128 r1 = _mm_mul_ps(_mm_setr_ps(data[ys[1] + xs[0]], data[ys[1] + xs[1]], data[ys[1] + xs[2]], data[ys[1] + xs[3]]), wx);
+        __m128 r2 = _mm_mul_ps(_mm_setr_ps(data[ys[2] + xs[0]], data[ys[2] + xs[1]], data[ys[2] + xs[2]], data[ys[2] + xs[3]]), wx);
+        __m128 r3 = _mm_mul_ps(_mm_setr_ps(data[ys[3] + xs[0]], data[ys[3] + xs[1]], data[ys[3] + xs[2]], data[ys[3] + xs[3]]), wx);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        __m128 rows = _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3));
+        return fmaxf(horizontalSum(_mm_mul_ps(rows, wy)), 0.f);
+    }
+    else {
+        alignas(16) float wyf[4];
+        _mm_store_ps(wyf, wy);
+#if defined(__AVX__)
+        // Two taps per 256-bit register
+        __m256 wx01 = _mm256_set_m128(broadcast<1>(wx), broadcast<0>(wx));
+        __m256 wx23 = _mm256_set_m128(broadcast<3>(wx), broadcast<2>(wx));
+        __m256 acc = _mm256_setzero_ps();
+        for (int j = 0; j < 4; j++) {
+            const T* row = data + ys[j];
+            __m256 rowWeight = _mm256_set1_ps(wyf[j]);
+            __m256 t01 = _mm256_set_m128(TexelSSE<T>::load(row[xs[1]]), TexelSSE<T>::load(row[xs[0]]));
+            __m256 t23 = _mm256_set_m128(TexelSSE<T>::load(row[xs[3]]), TexelSSE<T>::load(row[xs[2]]));
+            __m256 rowAcc = _mm256_add_ps(_mm256_mul_ps(t01, wx01), _mm256_mul_ps(t23, wx23));
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(rowAcc, rowWeight));
+        }
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        return TexelSSE<T>::store(_mm_max_ps(sum, zero));
+#else
+        __m128 wx0 = broadcast<0>(wx), wx1 = broadcast<1>(wx), wx2 = broadcast<2>(wx), wx3 = broadcast<3>(wx);
+        __m128 acc = _mm_setzero_ps();
+        for (int j = 0; j < 4; j++) {
+            const T* row = data + ys[j];
+            __m128 rowAcc = _mm_mul_ps(TexelSSE<T>::load(row[xs[0]]), wx0);
+            rowAcc = _mm_add_ps(rowAcc, _mm_mul_ps(TexelSSE<T>::load(row[xs[1]]), wx1));
+            rowAcc = _mm_add_ps(rowAcc, _mm_mul_ps(TexelSSE<T>::load(row[xs[2]]), wx2));
+            rowAcc = _mm_add_ps(rowAcc, _mm_mul_ps(TexelSSE<T>::load(row[xs[3]]), wx3));
+            acc = _mm_add_ps(acc, _mm_mul_ps(rowAcc, _mm_set1_ps(wyf[j])));
+        }
+        return TexelSSE<T>::store(_mm_max_ps(acc, zero));
+#endif
+    }
+#else
+    float wx[4], wy[4];
+    cubicWeights(lookup.frac.x, wx);
+    cubicWeights(lookup.frac.y, wy);
+    T result = T(0.f);
+    for (int j = 0; j < 4; j++) {
+        const T* row = data + ys[j];
+        result += wy[j] * (wx[0] * row[xs[0]] + wx[1] * row[xs[1]] + wx[2] * row[xs[2]] + wx[3] * row[xs[3]]);
+    }
+    return glm::max(result, T(0.f));
+#endif
+}
+
+template<typename T>
+T Texture<T>::eval(const glm::vec2& uv) const {
+    TexelLookup lookup(uv);
+    return eval(lookup);
 }
 
+template<typename T>
+T Texture<T>::eval(TexelLookup& lookup) const {
+    if (lookup.dims != image->getDims() || lookup.wrapU != wrapU || lookup.wrapV != wrapV || lookup.filter != filter) {
+        computeLookup(lookup);
+    }
+
+    switch (filter) {
+    case FilterMode::BILINEAR:
+        return evalBilinear(lookup);
+    case FilterMode::BICUBIC:
+        return evalBicubic(lookup);
+    default:
+        return image->read(lookup.index);
+    }
+}
 
+template class Lykta::Texture<float>;
+template class Lykta::Texture<glm::vec3>;
+template class Lykta::Texture<glm::vec4>;
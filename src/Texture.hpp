@@ -5,12 +5,55 @@
 
 namespace Lykta {
 
+    // How UV coordinates outside of [0, 1] are mapped back onto the image
+    enum class WrapMode {
+        REPEAT = 0,
+        CLAMP = 1,
+        MIRROR = 2
+    };
+
+    // Reconstruction filter used between texel centers
+    enum class FilterMode {
+        NEAREST = 0,
+        BILINEAR = 1,
+        BICUBIC = 2
+    };
+
+    // Texel footprint computed for one UV coordinate. A material passes the same
+    // lookup to all of its textures so that textures with equal dimensions,
+    // wrap and filter modes reuse the index math instead of recomputing it.
+    struct TexelLookup {
+        glm::vec2 uv;
+        glm::ivec2 dims;
+        WrapMode wrapU, wrapV;
+        FilterMode filter;
+
+        // Nearest texel index
+        int index;
+        // Top-left filter tap and position within the texel
+        glm::ivec2 texel;
+        glm::vec2 frac;
+
+        TexelLookup(const glm::vec2& texcoord) : uv(texcoord), dims(-1), wrapU(WrapMode::REPEAT),
+            wrapV(WrapMode::REPEAT), filter(FilterMode::NEAREST), index(0), texel(0), frac(0.f) {}
+    };
+
     template <typename T>
     class Texture {
     private:
         ImagePtr<T> image;
+        WrapMode wrapU = WrapMode::REPEAT;
+        WrapMode wrapV = WrapMode::REPEAT;
+        FilterMode filter = FilterMode::NEAREST;
+
+        void computeLookup(TexelLookup& lookup) const;
+        T evalBilinear(const TexelLookup& lookup) const;
+        T evalBicubic(const TexelLookup& lookup) const;
+
     public:
-        Texture(const std::string& path);
+        Texture(const std::string& path, WrapMode wrapMode = WrapMode::REPEAT, FilterMode filterMode = FilterMode::NEAREST);
+        Texture(ImagePtr<T> img, WrapMode wrapMode = WrapMode::REPEAT, FilterMode filterMode = FilterMode::NEAREST)
+            : image(img), wrapU(wrapMode), wrapV(wrapMode), filter(filterMode) {}
         Texture() {}
         ~Texture() {}
 
@@ -25,9 +68,30 @@ namespace Lykta {
 			return image;
 		}
 
+        WrapMode getWrapModeU() const {
+            return wrapU;
+        }
+
+        WrapMode getWrapModeV() const {
+            return wrapV;
+        }
+
+        // Separate modes along u and v, e.g. repeat around and clamp at the poles of a latlong map
+        void setWrapModes(WrapMode u, WrapMode v) {
+            wrapU = u;
+            wrapV = v;
+        }
+
+        FilterMode getFilterMode() const {
+            return filter;
+        }
+
         // Read value from image based on UV coord
         T eval(const glm::vec2& uv) const;
 
+        // Read value reusing the footprint in lookup when possible
+        T eval(TexelLookup& lookup) const;
+
     };
 
     template <typename T>
@@ -0,0 +1,100 @@
+#include "Trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+using namespace Lykta;
+
+namespace {
+	struct RetiredBuffer {
+		int thread;
+		std::vector<Trace::Event> events;
+	};
+
+	struct Registry {
+		std::mutex mutex;
+		std::vector<Trace::ThreadBuffer*> threads;
+		// Events of threads that have exited, in recording order
+		std::vector<RetiredBuffer> retired;
+		int nextThread = 0;
+	};
+
+	Registry& registry() {
+		static Registry instance;
+		return instance;
+	}
+
+	// Events of a ring buffer from oldest to newest
+	std::vector<Trace::Event> orderedEvents(const Trace::ThreadBuffer& buffer) {
+		std::vector<Trace::Event> result;
+		uint64_t first = (buffer.count > (uint64_t)Trace::CAPACITY) ? buffer.count - Trace::CAPACITY : 0;
+		for (uint64_t k = first; k < buffer.count; k++) result.push_back(buffer.events[k % Trace::CAPACITY]);
+		return result;
+	}
+}
+
+std::atomic<bool> Trace::enabled(false);
+thread_local Trace::ThreadBuffer Trace::local;
+
+Trace::ThreadBuffer::ThreadBuffer() {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	thread = r.nextThread++;
+	r.threads.push_back(this);
+}
+
+Trace::ThreadBuffer::~ThreadBuffer() {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	if (count > 0) r.retired.push_back({ thread, orderedEvents(*this) });
+	r.threads.erase(std::remove(r.threads.begin(), r.threads.end(), this), r.threads.end());
+}
+
+void Trace::setEnabled(bool enable) {
+	if (enable && !isEnabled()) {
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		for (ThreadBuffer* buffer : r.threads) buffer->count = 0;
+		r.retired.clear();
+	}
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+int64_t Trace::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool Trace::write(const std::string& filename) {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	std::vector<RetiredBuffer> buffers = r.retired;
+	for (const ThreadBuffer* buffer : r.threads) {
+		if (buffer->count > 0) buffers.push_back({ buffer->thread, orderedEvents(*buffer) });
+	}
+
+	FILE* file = fopen(filename.c_str(), "w");
+	if (!file) return false;
+
+	// Timestamps in microseconds relative to the first event
+	int64_t origin = INT64_MAX;
+	for (const RetiredBuffer& buffer : buffers) {
+		for (const Event& event : buffer.events) origin = std::min(origin, event.start);
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first = true;
+	for (const RetiredBuffer& buffer : buffers) {
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+			first ? "" : ",\n", buffer.thread, buffer.thread);
+		first = false;
+		for (const Event& event : buffer.events) {
+			fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"lykta\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+				event.name, buffer.thread, (event.start - origin) * 1e-3, event.duration * 1e-3);
+			if (event.index >= 0) fprintf(file, ",\"args\":{\"index\":%lld}", (long long)event.index);
+			fprintf(file, "}");
+		}
+	}
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
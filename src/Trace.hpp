@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace Lykta {
+
+	// Timeline of scoped events in Chrome trace format, viewable in Perfetto or
+	// chrome://tracing. Every thread records into its own ring buffer, which keeps
+	// the latest CAPACITY events, so recording takes no locks. While tracing is
+	// disabled a scope costs one relaxed load.
+	class Trace {
+	public:
+		static const int CAPACITY = 1 << 15;
+
+		struct Event {
+			// String literal, names are not copied
+			const char* name;
+			int64_t start, duration;
+			// Optional index shown as args.index, e.g. the row or pass, -1 for none
+			int64_t index;
+		};
+
+		struct ThreadBuffer {
+			std::vector<Event> events;
+			uint64_t count = 0;
+			int thread;
+
+			ThreadBuffer();
+			~ThreadBuffer();
+
+			void record(const Event& event) {
+				if (events.empty()) events.resize(CAPACITY);
+				events[count % CAPACITY] = event;
+				count++;
+			}
+		};
+
+		static bool isEnabled() {
+			return enabled.load(std::memory_order_relaxed);
+		}
+
+		// Clears all buffers when enabling. Call while no thread is recording.
+		static void setEnabled(bool enable);
+
+		// Nanoseconds since an arbitrary fixed point
+		static int64_t now();
+
+		static void record(const Event& event) {
+			local.record(event);
+		}
+
+		// Writes the events of all threads as Chrome trace JSON. Call while no
+		// thread is recording. Returns false if the file can't be written.
+		static bool write(const std::string& filename);
+
+	private:
+		static std::atomic<bool> enabled;
+		static thread_local ThreadBuffer local;
+	};
+
+	// Records an event covering the lifetime of the object when tracing is enabled
+	class TraceScope {
+	private:
+		const char* name;
+		int64_t index;
+		int64_t start;
+
+	public:
+		TraceScope(const char* n, int64_t i = -1) : name(n), index(i), start(Trace::isEnabled() ? Trace::now() : -1) {}
+
+		~TraceScope() {
+			if (start >= 0) Trace::record({ name, start, Trace::now() - start, index });
+		}
+	};
+}
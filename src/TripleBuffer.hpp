@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+
+namespace Lykta {
+
+	// Single producer, single consumer triple buffer. The producer fills the back
+	// slot and publishes it, the consumer swaps in the latest published slot.
+	// Neither side ever waits for the other, frames that are never picked up are
+	// overwritten by newer ones.
+	template <typename T>
+	class TripleBuffer {
+	private:
+		T slots[3];
+		// Index of the middle slot, FRESH is set while it holds an unread frame
+		std::atomic<int> middle;
+		int back, front;
+		static const int FRESH = 4;
+
+	public:
+		TripleBuffer() : middle(1), back(0), front(2) {}
+
+		// Producer side
+		T& getBack() {
+			return slots[back];
+		}
+
+		void publish() {
+			back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+		}
+
+		// Consumer side, returns false if nothing was published since the last update
+		bool update() {
+			if (!(middle.load(std::memory_order_acquire) & FRESH)) return false;
+			front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+			return true;
+		}
+
+		const T& getFront() const {
+			return slots[front];
+		}
+	};
+}
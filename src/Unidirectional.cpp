@@ -1,11 +1,12 @@
 #include "Integrator.hpp"
 #include "Emitter.hpp"
+#include "Statistics.hpp"
 #include <iostream>
 #include <cmath>
 
 using namespace Lykta;
 
-glm::vec3 Unidirectional::evaluate(const Ray& ray, const std::shared_ptr<Scene> scene) {
+glm::vec3 Unidirectional::evaluate(const Ray& ray, const std::shared_ptr<Scene> scene, Sampler& sampler, AOVSample& aov) {
 	glm::vec3 result = glm::vec3(0.f);
 	glm::vec3 throughput = glm::vec3(1.f);
 	Ray r = ray;
@@ -15,13 +16,16 @@ glm::vec3 Unidirectional::evaluate(const Ray& ray, const std::shared_ptr<Scene>
 	
 	Lykta::Hit hit = Hit();
 	bool intersected = scene->intersect(r, hit);
+	Statistics::count(Statistics::PRIMARY_RAYS);
 	EmitterPtr environment = scene->getEnvironment();
 
 	if (!intersected) {
 		if (environment) {
 			EmitterInteraction envei;
 			envei.direction = r.d;
-			return environment->eval(envei);
+			glm::vec3 contribution = environment->eval(envei);
+			aov.addLight(contribution, environment->getLightGroup(), 0);
+			return contribution;
 		}
 		else {
 			return glm::vec3(0.f);
@@ -37,21 +41,29 @@ glm::vec3 Unidirectional::evaluate(const Ray& ray, const std::shared_ptr<Scene>
 	EmitterInteraction ei(hit.pos, r.o, hit.normal, r.d);
 	glm::vec3 emitterEval = (emitter) ? emitter->eval(ei) : glm::vec3(0.f);
     MaterialParameters params = material->evalMaterialParameters(hit.texcoord);
+	aov.setSurface(material->evalAlbedo(params), hit.normal, glm::length(hit.pos - r.o));
 	
 	while (intersected) {
 
 		// Add material contribution if hit emitter
 		if (emitter != nullptr) {
-			if (!std::isnan(misWeightMat))
-				result += misWeightMat * throughput * emitterEval;
+			if (!std::isnan(misWeightMat)) {
+				glm::vec3 contribution = misWeightMat * throughput * emitterEval;
+				result += contribution;
+				aov.addLight(contribution, emitter->getLightGroup(), bounces - 1);
+			}
 		}
 
 		// RR
 		// comes after material contribution to make sure bounce count is equal
 		// between emitter sampling and material sampling
-		float s = RND::next1D();
+		// Every bounce consumes 7 sampler dimensions: RR, emitter, emitter sample and BSDF sample
+		float s = sampler.get1D();
 		float success = fminf(0.75f, Lykta::luminance(throughput));
-		if (s < (1 - success)) break;
+		if (s < (1 - success)) {
+			Statistics::count(Statistics::ROULETTE_TERMINATIONS);
+			break;
+		}
 		throughput /= success;
 
 		// Create basis
@@ -61,10 +73,12 @@ glm::vec3 Unidirectional::evaluate(const Ray& ray, const std::shared_ptr<Scene>
 		// Sample emitter
 		{
 			ei = EmitterInteraction(hit.pos);
-			const EmitterPtr emitter = scene->getRandomEmitter(RND::next1D());
-			glm::vec3 Le = emitter->sample(RND::next3D(), ei);
+			const EmitterPtr emitter = scene->getRandomEmitter(sampler.get1D());
+			glm::vec3 Le = emitter->sample(sampler.get3D(), ei);
 			Hit tmp = Hit();
+			Statistics::count(Statistics::SHADOW_RAYS);
 			if (!scene->intersect(ei.shadowRay, tmp)) {
+				Statistics::count(Statistics::NEE_HITS);
 				float emitterPDF = ei.pdf;
 				SurfaceInteraction si = SurfaceInteraction();
 				si.wi = glm::normalize(basis.toLocalSpace(-r.d));
@@ -77,7 +91,9 @@ glm::vec3 Unidirectional::evaluate(const Ray& ray, const std::shared_ptr<Scene>
 				misWeightEmitter = balanceHeuristic(emitterPDF, materialPDF);
 				if (!std::isnan(misWeightEmitter)) {
 					float nl = abs(glm::dot(ei.direction, hit.normal));
-					result += numLights * misWeightEmitter * nl * throughput * materialEval * Le;
+					glm::vec3 contribution = numLights * misWeightEmitter * nl * throughput * materialEval * Le;
+					result += contribution;
+					aov.addLight(contribution, emitter->getLightGroup(), bounces);
 				}
 			}
 		}
@@ -87,11 +103,12 @@ glm::vec3 Unidirectional::evaluate(const Ray& ray, const std::shared_ptr<Scene>
 		si.uv = hit.texcoord;
 		si.pos = hit.pos;
 		si.wi = glm::normalize(basis.toLocalSpace(-r.d));
-        glm::vec3 color = material->sample(RND::next2D(), si, params);
+        glm::vec3 color = material->sample(sampler.get2D(), si, params);
 		glm::vec3 out = glm::normalize(basis.fromLocalSpace(si.wo));
 		r = Ray(hit.pos, out);
 		hit = Hit();
 		intersected = scene->intersect(r, hit);
+		Statistics::count(Statistics::BOUNCE_RAYS);
 		throughput *= color;
 
 		if (intersected) {
@@ -115,7 +132,9 @@ glm::vec3 Unidirectional::evaluate(const Ray& ray, const std::shared_ptr<Scene>
 			ei.direction = r.d;
 			emitterEval = environment->eval(ei);
 			misWeightMat = balanceHeuristic(si.pdf, ei.pdf);
-			result += misWeightMat * throughput * emitterEval;
+			glm::vec3 contribution = misWeightMat * throughput * emitterEval;
+			result += contribution;
+			aov.addLight(contribution, environment->getLightGroup(), bounces);
 		}
 		
 		bounces++;
@@ -0,0 +1,250 @@
+#include "Integrator.hpp"
+#include "Emitter.hpp"
+#include "Statistics.hpp"
+#include "Trace.hpp"
+#include <cstdio>
+#include <map>
+
+using namespace Lykta;
+
+namespace {
+	// Stable LSD radix sort of indices by keys[index], one counting pass per byte
+	// of the largest key. Less than 256 materials need a single pass.
+	void radixSort(std::vector<uint32_t>& order, const std::vector<uint16_t>& keys, int maxKey, std::vector<uint32_t>& scratch) {
+		size_t n = order.size();
+		scratch.resize(n);
+		int passes = (maxKey > 0xff) ? 2 : 1;
+		for (int pass = 0; pass < passes; pass++) {
+			int shift = 8 * pass;
+			size_t offsets[256] = {};
+			for (size_t k = 0; k < n; k++) offsets[(keys[order[k]] >> shift) & 0xff]++;
+
+			size_t sum = 0;
+			for (int d = 0; d < 256; d++) {
+				size_t c = offsets[d];
+				offsets[d] = sum;
+				sum += c;
+			}
+
+			for (size_t k = 0; k < n; k++) {
+				uint32_t index = order[k];
+				scratch[offsets[(keys[index] >> shift) & 0xff]++] = index;
+			}
+			order.swap(scratch);
+		}
+	}
+}
+
+void WavefrontIntegrator::preprocess(const std::shared_ptr<Scene> scene) {
+	if (!scene) return;
+
+	// Keys in order of first use, geometries sharing a material share its key
+	const std::vector<MeshPtr> meshes = scene->getMeshes();
+	std::map<const SurfaceMaterial*, int> indices;
+	geometryMaterials.resize(meshes.size());
+	materialKeys.resize(meshes.size());
+	for (size_t g = 0; g < meshes.size(); g++) {
+		geometryMaterials[g] = meshes[g]->material;
+		auto it = indices.insert(std::make_pair(meshes[g]->material.get(), (int)indices.size())).first;
+		materialKeys[g] = (uint16_t)std::min(it->second, 0xffff);
+	}
+	numMaterials = (int)indices.size();
+}
+
+bool WavefrontIntegrator::evaluateFrame(const std::vector<Ray>& rays, const std::shared_ptr<Scene> scene, const Sampler& sampler,
+	uint32_t sampleIndex, int width, std::vector<glm::vec3>& radiance, std::vector<AOVSample>& aovs,
+	const std::atomic<bool>& cancel) {
+	int numPixels = (int)rays.size();
+	radiance.assign(numPixels, glm::vec3(0.f));
+	paths.resize(numPixels);
+
+	#pragma omp parallel for
+	for (int i = 0; i < numPixels; i++) {
+		aovs[i].reset();
+		PathState& path = paths[i];
+		path.ray = rays[i];
+		path.throughput = glm::vec3(1.f);
+		path.pixel = i;
+		path.bounces = 0;
+	}
+
+	EmitterPtr environment = scene->getEnvironment();
+	for (int bounce = 0; !paths.empty(); bounce++) {
+		// Checked between bounces and packets, like the renderer does between rows
+		if (cancel) return false;
+		int n = (int)paths.size();
+		hits.resize(n);
+		alive.assign(n, 0);
+		TraceScope trace("bounce", bounce);
+
+		// Paths leaving the scene pick up the environment and end
+		{
+			TraceScope phase("intersect");
+			#pragma omp parallel for schedule(dynamic, 256)
+			for (int i = 0; i < n; i++) {
+				PathState& path = paths[i];
+				Statistics::count((path.bounces == 0) ? Statistics::PRIMARY_RAYS : Statistics::BOUNCE_RAYS);
+				if (scene->intersect(path.ray, hits[i])) {
+					alive[i] = 1;
+					continue;
+				}
+
+				if (environment) {
+					EmitterInteraction ei;
+					ei.direction = path.ray.d;
+					glm::vec3 contribution = path.throughput * environment->eval(ei);
+					radiance[path.pixel] += contribution;
+					aovs[path.pixel].addLight(contribution, environment->getLightGroup(), path.bounces);
+				}
+			}
+		}
+
+		// Shading order of the hits, keys are indexed by path
+		{
+			TraceScope phase("sort");
+			order.clear();
+			keys.resize(n);
+			for (int i = 0; i < n; i++) {
+				if (!alive[i]) continue;
+				order.push_back((uint32_t)i);
+				keys[i] = materialKeys[hits[i].geomID];
+			}
+			if (sortByMaterial) radixSort(order, keys, numMaterials - 1, scratch);
+
+			// Packets hold up to SIMD_WIDTH consecutive hits of one material
+			packets.clear();
+			const SurfaceMaterial* previous = nullptr;
+			for (size_t k = 0; k < order.size(); k++) {
+				const SurfaceMaterial* material = geometryMaterials[hits[order[k]].geomID].get();
+				if (material != previous) {
+					stats.runs++;
+					previous = material;
+					packets.push_back(glm::ivec2((int)k, 0));
+				}
+				else if (packets.back().y == SIMD_WIDTH) {
+					packets.push_back(glm::ivec2((int)k, 0));
+				}
+				packets.back().y++;
+			}
+			stats.batches++;
+			stats.hits += order.size();
+			stats.packets += packets.size();
+		}
+
+		{
+			TraceScope phase("shade");
+			#pragma omp parallel
+			{
+				std::unique_ptr<Sampler> pathSampler = sampler.clone();
+
+				#pragma omp for schedule(dynamic, 16)
+				for (int p = 0; p < (int)packets.size(); p++) {
+					if (cancel) continue;
+					shadePacket(scene, *pathSampler, sampleIndex, width, order.data() + packets[p].x, packets[p].y, radiance, aovs);
+				}
+			}
+		}
+
+		// Survivors stay in pixel order, which keeps the rays of the next bounce coherent
+		nextPaths.clear();
+		for (int i = 0; i < n; i++) {
+			if (alive[i]) nextPaths.push_back(paths[i]);
+		}
+		paths.swap(nextPaths);
+	}
+	return !cancel;
+}
+
+void WavefrontIntegrator::shadePacket(const std::shared_ptr<Scene>& scene, Sampler& sampler, uint32_t sampleIndex, int width,
+	const uint32_t* indices, int count, std::vector<glm::vec3>& radiance, std::vector<AOVSample>& aovs) {
+	const MaterialPtr& material = geometryMaterials[hits[indices[0]].geomID];
+
+	float u[SIMD_WIDTH] = {}, v[SIMD_WIDTH] = {};
+	for (int l = 0; l < count; l++) {
+		u[l] = hits[indices[l]].texcoord.x;
+		v[l] = hits[indices[l]].texcoord.y;
+	}
+	MaterialParametersN params = material->evalMaterialParameters(Vec2N(FloatN::load(u), FloatN::load(v)), simd::firstLanes(count));
+
+	float albedo[3][SIMD_WIDTH];
+	Vec3N albedoN = material->evalAlbedo(params);
+	albedoN.x.store(albedo[0]);
+	albedoN.y.store(albedo[1]);
+	albedoN.z.store(albedo[2]);
+
+	// Emission, russian roulette and the BSDF sample inputs per lane
+	float wi[3][SIMD_WIDTH] = {}, samples[2][SIMD_WIDTH] = {};
+	int sampled = 0;
+	glm::vec3 emission = material->getEmission();
+	for (int l = 0; l < count; l++) {
+		uint32_t i = indices[l];
+		PathState& path = paths[i];
+		Hit& hit = hits[i];
+		AOVSample& aov = aovs[path.pixel];
+
+		if (path.bounces == 0) {
+			aov.setSurface(glm::vec3(albedo[0][l], albedo[1][l], albedo[2][l]), hit.normal, glm::length(hit.pos - path.ray.o));
+		}
+
+		if (maxComponent(emission) > 0.f) {
+			glm::vec3 contribution = path.throughput * emission;
+			radiance[path.pixel] += contribution;
+			aov.addLight(contribution, material->getLightGroup(), path.bounces);
+		}
+
+		// BSDFIntegrator draws one RR and one BSDF sample per bounce after the camera dimensions
+		sampler.startPixelSample(glm::ivec2(path.pixel % width, path.pixel / width), sampleIndex, 4 + 3 * path.bounces);
+		float s = sampler.get1D();
+		float success = fminf(0.75f, luminance(path.throughput));
+		if (s < (1 - success)) {
+			Statistics::count(Statistics::ROULETTE_TERMINATIONS);
+			alive[i] = 0;
+			continue;
+		}
+		path.throughput /= success;
+
+		material->evalShadingNormal(hit.normal, path.ray.d, hit.texcoord);
+		Basis basis = Basis(hit.normal);
+		glm::vec3 w = glm::normalize(basis.toLocalSpace(-path.ray.d));
+		glm::vec2 sample = sampler.get2D();
+		for (int c = 0; c < 3; c++) wi[c][l] = w[c];
+		samples[0][l] = sample.x;
+		samples[1][l] = sample.y;
+		sampled |= 1 << l;
+	}
+
+	if (!sampled) return;
+
+	SurfaceInteractionN si;
+	si.wi = Vec3N(FloatN::load(wi[0]), FloatN::load(wi[1]), FloatN::load(wi[2]));
+	si.wo = Vec3N(FloatN(0.f));
+	Vec3N colorN = material->sample(Vec2N(FloatN::load(samples[0]), FloatN::load(samples[1])), si, params);
+
+	float color[3][SIMD_WIDTH], wo[3][SIMD_WIDTH];
+	colorN.x.store(color[0]);
+	colorN.y.store(color[1]);
+	colorN.z.store(color[2]);
+	si.wo.x.store(wo[0]);
+	si.wo.y.store(wo[1]);
+	si.wo.z.store(wo[2]);
+
+	for (int l = 0; l < count; l++) {
+		if (!((sampled >> l) & 1)) continue;
+		PathState& path = paths[indices[l]];
+		const Hit& hit = hits[indices[l]];
+		Basis basis = Basis(hit.normal);
+		glm::vec3 out = glm::normalize(basis.fromLocalSpace(glm::vec3(wo[0][l], wo[1][l], wo[2][l])));
+		path.throughput *= glm::vec3(color[0][l], color[1][l], color[2][l]);
+		path.ray = Ray(hit.pos, out);
+		path.bounces++;
+	}
+}
+
+std::string WavefrontIntegrator::getStatistics() const {
+	if (stats.batches == 0 || stats.hits == 0) return "";
+	char buffer[256];
+	snprintf(buffer, sizeof(buffer), "Shading %s: %.1f material runs per batch, %.1f hits per run, %.0f%% of packet lanes used",
+		sortByMaterial ? "sorted by material" : "unsorted", (double)stats.runs / stats.batches,
+		(double)stats.hits / stats.runs, 100.0 * stats.hits / ((double)stats.packets * SIMD_WIDTH));
+	return buffer;
+}
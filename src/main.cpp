@@ -6,7 +6,7 @@ int main(int argc, char** argv)
 {
 	try {
 		
-		if (argc == 2 || argc == 3) {
+		if (argc >= 2) {
 			std::unique_ptr<Lykta::CommandLine> cmd = std::unique_ptr<Lykta::CommandLine>(new Lykta::CommandLine(argc, argv));
 		}
 		else {
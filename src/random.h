@@ -43,7 +43,7 @@ namespace Lykta {
 
 		uint64_t state, inc;
 
-		RandomSampler() : state(PCG32_DEFAULT_STATE), inc(PCG32_DEFAULT_STREAM) {}
+		constexpr RandomSampler() : state(PCG32_DEFAULT_STATE), inc(PCG32_DEFAULT_STREAM) {}
 
 		void seed(uint64_t initstate, uint64_t initseq = 1) {
 			state = 0U;
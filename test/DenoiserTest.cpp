@@ -0,0 +1,50 @@
+#include <iostream>
+#include <math.h>
+#include "Denoiser.hpp"
+
+using namespace Lykta;
+
+// Regression test for partly covered pixels. Their accumulated normal is shorter
+// than one, which used to make every filter weight underflow to zero.
+int main() {
+	const int width = 16, height = 8;
+	Image<glm::vec3> image = Image<glm::vec3>(width, height);
+	Image<glm::vec3> albedo = Image<glm::vec3>(width, height);
+	Image<glm::vec3> normal = Image<glm::vec3>(width, height);
+
+	// Left half a surface facing the camera, right half background, and a
+	// column of half covered pixels along the silhouette
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			int i = y * width + x;
+			float coverage = (x < width / 2) ? 1.f : (x == width / 2) ? 0.5f : 0.f;
+			image[i] = glm::vec3(coverage * (0.5f + 0.1f * ((x + y) % 3)));
+			albedo[i] = glm::vec3(coverage * 0.8f);
+			normal[i] = coverage * glm::vec3(0.f, 0.f, 1.f);
+		}
+	}
+
+	// One pixel seen edge-on, with normals of the samples cancelling out
+	normal[2 * width + 3] = glm::vec3(0.f, 0.f, 0.1f);
+
+	Denoiser().denoise(image, albedo, normal);
+
+	int failures = 0;
+	for (int i = 0; i < width * height; i++) {
+		const glm::vec3& c = image[i];
+		if (!std::isfinite(c.x) || !std::isfinite(c.y) || !std::isfinite(c.z)) {
+			std::cout << "Pixel " << i % width << ", " << i / width << " is not finite" << std::endl;
+			failures++;
+		}
+	}
+
+	// Half covered pixels keep a value between background and surface
+	float silhouette = image[3 * width + width / 2].x;
+	if (!(silhouette > 0.f && silhouette < 1.f)) {
+		std::cout << "Silhouette pixel out of range: " << silhouette << std::endl;
+		failures++;
+	}
+
+	std::cout << ((failures == 0) ? "Denoiser test passed" : "Denoiser test failed") << std::endl;
+	return (failures == 0) ? 0 : 1;
+}